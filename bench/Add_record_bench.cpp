@@ -0,0 +1,64 @@
+/* Add throughput: adds synthetic Records to an empty Library one at a
+time, as ar does, and reports the rate and the latency of each add. The
+server publishes after every change, so each add copies the path to its
+leaf in the published version's tree and retires the old nodes; outside
+the server the Library publishes only before a command that reads it, so
+the adds change the working version's nodes in place. Both are timed.
+Usage: Add_record_bench [records]
+*/
+
+#include "Bench_util.h"
+#include "Library.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// Return the latency at the fraction of the sorted latencies
+double percentile(const vector<double>& sorted, double fraction)
+{
+    return sorted.empty() ? 0 : sorted[min(sorted.size() - 1, static_cast<size_t>(fraction * sorted.size()))];
+}
+
+// Add the titles one at a time, publishing after each add if asked to,
+// and print the rate and the latencies
+void run(const vector<string>& titles, bool publish_each)
+{
+    Library lib;
+    vector<double> latencies;
+    latencies.reserve(titles.size());
+
+    Bench_timer total_timer;
+    for (const string& title : titles) {
+        Bench_timer timer;
+        lib.add_record("DVD", title);
+        if (publish_each)
+            lib.publish();
+        latencies.push_back(timer.seconds() * 1e9);
+    }
+    lib.publish();
+    double seconds = total_timer.seconds();
+
+    sort(latencies.begin(), latencies.end());
+    printf("%zu records, %-22s %9.0f records/s; latency p50 %6.0f ns, p99 %6.0f ns, max %8.0f ns\n", titles.size(),
+        publish_each ? "publishing each add:" : "publishing at the end:", titles.size() / seconds,
+        percentile(latencies, 0.5), percentile(latencies, 0.99), latencies.empty() ? 0 : latencies.back());
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    size_t num_records = argc > 1 ? strtoul(argv[1], nullptr, 10) : 400000;
+
+    vector<string> titles = make_titles(num_records);
+    run(titles, false);
+    run(titles, true);
+    return 0;
+}
@@ -0,0 +1,60 @@
+/* Helpers shared by the benchmarks: a wall-clock timer, and the titles of
+a synthetic library, which are made from a fixed seed so every run
+measures the same data.
+*/
+
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include <chrono>
+#include <cstddef>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// Measures the time since it was started
+class Bench_timer
+{
+public:
+    Bench_timer()
+        : start(std::chrono::steady_clock::now())
+    { }
+
+    // Return the seconds since the timer was started
+    double seconds() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start;
+};
+
+// Return n different titles of two to five words, in random order
+inline std::vector<std::string> make_titles(std::size_t n)
+{
+    static const char* const words[] = {"Alien", "blue", "Day", "Star", "night", "House", "of", "the", "Wars",
+        "love", "Moon", "red", "Zed", "a", "River", "Return", "King", "empire", "Time", "Dream"};
+    const std::size_t num_words = sizeof(words) / sizeof(words[0]);
+
+    std::mt19937 random(12345);
+    std::unordered_set<std::string> seen;
+    std::vector<std::string> titles;
+    titles.reserve(n);
+    while (titles.size() < n) {
+        std::string title;
+        std::size_t length = 2 + random() % 4;
+        for (std::size_t i = 0; i < length; ++i) {
+            if (i > 0)
+                title += ' ';
+            title += words[random() % num_words];
+        }
+        title += ' ' + std::to_string(random() % 1000000);
+        if (seen.insert(title).second)
+            titles.push_back(title);
+    }
+    return titles;
+}
+
+#endif
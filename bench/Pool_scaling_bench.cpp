@@ -0,0 +1,96 @@
+/* Thread pool scaling: times the work that runs on the pool over a
+synthetic library, for one thread count per run. fs runs both of its
+paths, the scan of the whole title buffer for a short query and the
+check of trigram candidates for a longer one, and pL's output is
+formatted in parts as print_entries does. The thread count is fixed for
+the life of the process, so it is given on the command line; run the
+program once for each count to compare them.
+Usage: Pool_scaling_bench [threads [records]]
+*/
+
+#include "Bench_util.h"
+#include "Epoch.h"
+#include "Library.h"
+#include "Library_version.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+const int num_runs = 5;
+
+// Return the best time of the runs of func, in milliseconds
+template <typename F>
+double best_ms(F func)
+{
+    double best = 1e300;
+    for (int run = 0; run < num_runs; ++run) {
+        Bench_timer timer;
+        func();
+        best = min(best, timer.seconds() * 1e3);
+    }
+    return best;
+}
+
+// Format the entries in windows of parts on the pool, as pL does, and
+// return the number of characters
+size_t format_entries(const vector<const Record_entry*>& entries)
+{
+    const size_t entries_per_window = 1 << 16;
+    const size_t min_entries_per_part = 1024;
+
+    size_t chars = 0;
+    for (size_t begin = 0; begin < entries.size(); begin += entries_per_window) {
+        size_t end = min(entries.size(), begin + entries_per_window);
+        vector<string> texts = parallel_collect(end - begin, min_entries_per_part, [&](size_t first, size_t last) {
+            ostringstream text;
+            for (size_t i = begin + first; i < begin + last; ++i)
+                text << *entries[i];
+            return text.str();
+        });
+        for (const string& text : texts)
+            chars += text.size();
+    }
+    return chars;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    size_t num_threads = argc > 1 ? strtoul(argv[1], nullptr, 10) : hardware_threads();
+    size_t num_records = argc > 2 ? strtoul(argv[2], nullptr, 10) : 1000000;
+    set_parallel_threads(max<size_t>(1, num_threads));
+
+    {
+        Library lib;
+        vector<string> titles = make_titles(num_records);
+        vector<Record_row> rows;
+        for (size_t i = 0; i < titles.size(); ++i)
+            rows.push_back({0, "DVD", titles[i], static_cast<int>(i % 6)});
+        lib.add_records(rows);
+        lib.publish();
+
+        size_t short_matches = 0, trigram_matches = 0, chars = 0;
+        double short_ms = best_ms([&] { short_matches = lib.find_containing("ze").size(); });
+        double trigram_ms = best_ms([&] { trigram_matches = lib.find_containing("moon h").size(); });
+
+        Epoch_guard guard;
+        vector<const Record_entry*> entries;
+        lib.get_version().for_each_by_title([&entries](const Record_entry& entry) { entries.push_back(&entry); });
+        double format_ms = best_ms([&] { chars = format_entries(entries); });
+
+        printf("%zu records, %2zu threads: fs short %7.1f ms (%zu), fs trigram %7.1f ms (%zu), pL format %7.1f ms "
+               "(%zu chars)\n",
+            num_records, parallel_threads(), short_ms, short_matches, trigram_ms, trigram_matches, format_ms, chars);
+    }
+    return 0;
+}
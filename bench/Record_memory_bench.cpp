@@ -0,0 +1,62 @@
+/* Memory per Record: fills a Library with synthetic Records spread over a
+handful of media and reports the bytes each Record costs in every
+memory category, as counted for pa. Media are interned, so the media
+add nothing per Record; the strings category holds the titles.
+*/
+
+#include "Bench_util.h"
+#include "Library.h"
+#include "Memory_usage.h"
+#include "Record.h"
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+const char* const media[] = {"DVD", "CD", "LP", "Blu-ray", "Cassette"};
+const size_t num_media = sizeof(media) / sizeof(media[0]);
+
+void run(size_t num_records)
+{
+    vector<string> titles = make_titles(num_records);
+    size_t title_chars = 0;
+    for (const string& title : titles)
+        title_chars += title.size();
+
+    size_t start[num_memory_categories];
+    for (int index = 0; index < num_memory_categories; ++index)
+        start[index] = memory_in_use(static_cast<Memory_category>(index));
+    size_t total_start = total_memory_in_use();
+
+    {
+        Library lib;
+        vector<Record_row> rows;
+        for (size_t i = 0; i < titles.size(); ++i)
+            rows.push_back({0, media[i % num_media], titles[i], 0});
+        lib.add_records(rows);
+        lib.publish();
+
+        printf("%zu records, sizeof(Record) %zu, %.1f title characters each on average\n", num_records,
+            sizeof(Record), double(title_chars) / num_records);
+        for (int index = 0; index < num_memory_categories; ++index) {
+            size_t bytes = memory_in_use(static_cast<Memory_category>(index)) - start[index];
+            if (bytes != 0)
+                printf("  %-26s %7.1f bytes/record\n", memory_category_name(static_cast<Memory_category>(index)),
+                    double(bytes) / num_records);
+        }
+        printf("  %-26s %7.1f bytes/record\n", "Total", double(total_memory_in_use() - total_start) / num_records);
+    }
+}
+
+}  // namespace
+
+int main()
+{
+    for (size_t num_records : {100000, 1000000})
+        run(num_records);
+    return 0;
+}
@@ -0,0 +1,93 @@
+/* Snapshot restore throughput: saves a synthetic Library and Catalog in
+the text and the binary format, then restores each one several times and
+reports the best rate in records per second, as rA does. The thread
+count is fixed for the life of the process, so it is given on the
+command line; run the program once for each count to compare them.
+Usage: Restore_bench [threads [records]]
+*/
+
+#include "Bench_util.h"
+#include "Catalog.h"
+#include "Collection.h"
+#include "Library.h"
+#include "Parallel.h"
+#include "Snapshot.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+const int num_runs = 3;
+const int num_collections = 10;
+
+// Fill the Library with the records, and the Catalog with Collections
+// that each hold a tenth of them
+void make_data(size_t num_records, Library& lib, Catalog& cat)
+{
+    vector<string> titles = make_titles(num_records);
+    vector<Record_row> rows;
+    for (size_t i = 0; i < titles.size(); ++i)
+        rows.push_back({0, i % 2 ? "DVD" : "CD", titles[i], static_cast<int>(i % 6)});
+    vector<Record*> records = lib.add_records(rows);
+
+    for (int c = 0; c < num_collections; ++c) {
+        vector<int> ids;
+        for (size_t i = c; i < records.size(); i += num_collections)
+            ids.push_back(records[i]->get_ID());
+        cat.add(Collection("Collection" + to_string(c), ids, lib), lib);
+    }
+}
+
+// Restore the file into an empty Library and Catalog several times and
+// return the best rate in records per second
+template <typename F>
+double best_rate(const string& file_name, F restore)
+{
+    double best = 0;
+    for (int run = 0; run < num_runs; ++run) {
+        {
+            Library lib;
+            Catalog cat;
+            Bench_timer timer;
+            restore(file_name, lib, cat);
+            best = max(best, lib.size() / timer.seconds());
+            cat.clear(lib);
+        }
+    }
+    return best;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    size_t num_threads = argc > 1 ? strtoul(argv[1], nullptr, 10) : hardware_threads();
+    size_t num_records = argc > 2 ? strtoul(argv[2], nullptr, 10) : 1000000;
+    set_parallel_threads(max<size_t>(1, num_threads));
+
+    const string text_file = "restore_bench.txt";
+    const string binary_file = "restore_bench.bin";
+    {
+        Library lib;
+        Catalog cat;
+        make_data(num_records, lib, cat);
+        save_text_snapshot(text_file, lib, cat);
+        save_binary_snapshot(binary_file, lib, cat);
+        cat.clear(lib);
+    }
+
+    double text_rate = best_rate(text_file, restore_text_snapshot);
+    double binary_rate = best_rate(binary_file, restore_binary_snapshot);
+    printf("%zu records, %zu threads: text %.0f records/s, binary %.0f records/s\n", num_records,
+        parallel_threads(), text_rate, binary_rate);
+
+    remove(text_file.c_str());
+    remove(binary_file.c_str());
+    return 0;
+}
@@ -0,0 +1,206 @@
+/* Socket server load: many clients send commands to a running
+manager --socket at once, and the throughput and the latency of each
+command, from sending it to reading the next prompt, are reported. A
+first client clears the server's Library with cL and adds the Records
+the others work on. Each client then runs
+its commands, waiting for each answer before sending the next: mostly
+reads (fr, pr, fs, lt, lb), and a share of writes (mr, mt) given as a
+percentage.
+Usage: Socket_load_bench socket-path [clients [commands [write-percent [records]]]]
+*/
+
+#include "Bench_util.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+const string prompt = "Enter command: ";
+
+// A connection to the server that sends a command and reads its answer
+class Connection
+{
+public:
+    // Connect to the socket and read the first prompt. Exit if the
+    // server cannot be reached.
+    explicit Connection(const string& path)
+    {
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+        if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            perror(path.c_str());
+            exit(1);
+        }
+        read_answer();
+    }
+    ~Connection()
+    {
+        send_command("qq");
+        close(fd);
+    }
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    // Send the command and wait for the prompt that follows its answer
+    void run(const string& command)
+    {
+        send_command(command);
+        read_answer();
+    }
+
+private:
+    void send_command(const string& command)
+    {
+        string line = command + '\n';
+        for (size_t sent = 0; sent < line.size();) {
+            ssize_t n = send(fd, line.data() + sent, line.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                perror("send");
+                exit(1);
+            }
+            sent += n;
+        }
+    }
+
+    // Read up to and including the next prompt
+    void read_answer()
+    {
+        size_t prompt_pos;
+        while ((prompt_pos = answer.find(prompt)) == string::npos) {
+            char buffer[65536];
+            ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+            if (n <= 0) {
+                fprintf(stderr, "The server closed the connection\n");
+                exit(1);
+            }
+            answer.append(buffer, n);
+        }
+        answer.erase(0, prompt_pos + prompt.size());
+    }
+
+    int fd;
+    string answer;
+};
+
+// Holds the clients back until all of them are connected
+class Start_line
+{
+public:
+    explicit Start_line(size_t num_clients_)
+        : num_waiting(num_clients_)
+    { }
+
+    void arrive_and_wait()
+    {
+        unique_lock<mutex> lock(start_mutex);
+        if (--num_waiting == 0)
+            started.notify_all();
+        started.wait(lock, [this] { return num_waiting == 0; });
+    }
+
+private:
+    mutex start_mutex;
+    condition_variable started;
+    size_t num_waiting;
+};
+
+// Return the command a client sends next
+string next_command(mt19937& random, int write_percent, size_t num_records)
+{
+    size_t id = 1 + random() % num_records;
+    if (static_cast<int>(random() % 100) < write_percent) {
+        if (random() % 2 == 0)
+            return "mr " + to_string(id) + " " + to_string(1 + random() % 5);
+        return "mt " + to_string(id) + " Load " + to_string(random() % 1000000000);
+    }
+    switch (random() % 5) {
+    case 0:
+        return "fr Load " + to_string(id);
+    case 1:
+        return "pr " + to_string(id);
+    case 2:
+        return "fs " + to_string(100 + id % 900);
+    case 3:
+        return "lt 20";
+    default:
+        return "lb 2 3";
+    }
+}
+
+// Return the latency at the fraction of the sorted latencies
+double percentile(const vector<double>& sorted, double fraction)
+{
+    return sorted.empty() ? 0 : sorted[min(sorted.size() - 1, static_cast<size_t>(fraction * sorted.size()))];
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s socket-path [clients [commands [write-percent [records]]]]\n", argv[0]);
+        return 1;
+    }
+    string path = argv[1];
+    size_t num_clients = argc > 2 ? strtoul(argv[2], nullptr, 10) : 16;
+    size_t num_commands = argc > 3 ? strtoul(argv[3], nullptr, 10) : 2000;
+    int write_percent = argc > 4 ? atoi(argv[4]) : 10;
+    size_t num_records = argc > 5 ? strtoul(argv[5], nullptr, 10) : 100000;
+
+    {
+        Connection setup(path);
+        setup.run("cL");
+        for (size_t i = 1; i <= num_records; ++i)
+            setup.run("ar DVD Load " + to_string(i));
+    }
+
+    vector<vector<double>> latencies(num_clients);
+    Start_line start_line(num_clients + 1);
+    vector<thread> clients;
+    for (size_t client = 0; client < num_clients; ++client) {
+        clients.emplace_back([&, client] {
+            Connection connection(path);
+            mt19937 random(client + 1);
+            vector<double>& client_latencies = latencies[client];
+            client_latencies.reserve(num_commands);
+            start_line.arrive_and_wait();
+            for (size_t i = 0; i < num_commands; ++i) {
+                string command = next_command(random, write_percent, num_records);
+                Bench_timer timer;
+                connection.run(command);
+                client_latencies.push_back(timer.seconds() * 1e6);
+            }
+        });
+    }
+    start_line.arrive_and_wait();
+    Bench_timer timer;
+    for (thread& client : clients)
+        client.join();
+    double seconds = timer.seconds();
+
+    vector<double> all;
+    for (const vector<double>& client_latencies : latencies)
+        all.insert(all.end(), client_latencies.begin(), client_latencies.end());
+    sort(all.begin(), all.end());
+    printf("%zu clients, %zu commands each, %d%% writes, %zu records: %.0f commands/s; latency p50 %.1f us, "
+           "p90 %.1f us, p99 %.1f us, max %.1f us\n",
+        num_clients, num_commands, write_percent, num_records, all.size() / seconds, percentile(all, 0.5),
+        percentile(all, 0.9), percentile(all, 0.99), all.empty() ? 0 : all.back());
+    return 0;
+}
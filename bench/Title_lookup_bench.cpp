@@ -0,0 +1,72 @@
+/* Title lookup: Library::find_title, which searches the title set with
+its own lower_bound, against std::lower_bound over the set's iterators,
+which is how titles were looked up before. The set's iterators are only
+bidirectional, so std::lower_bound steps through the set one node at a
+time and each lookup is linear; the old way is timed over fewer lookups.
+*/
+
+#include "Bench_util.h"
+#include "Library.h"
+#include "Utility.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+const size_t num_lookups = 1000000;
+
+// Return how many nanoseconds each lookup of a title took, on average,
+// and add the number of titles found to found
+template <typename F>
+double time_lookups(const vector<string>& titles, size_t lookups, F find, size_t& found)
+{
+    Bench_timer timer;
+    for (size_t i = 0; i < lookups; ++i) {
+        if (find(titles[i * 7919 % titles.size()]))
+            ++found;
+    }
+    return timer.seconds() * 1e9 / lookups;
+}
+
+void run(size_t num_records)
+{
+    vector<string> titles = make_titles(num_records);
+    size_t found = 0;
+    double set_ns, linear_ns;
+    {
+        Library lib;
+        vector<Record_row> rows;
+        for (const string& title : titles)
+            rows.push_back({0, "DVD", title, 0});
+        lib.add_records(rows);
+
+        set_ns = time_lookups(titles, num_lookups, [&](const string& title) { return lib.find_title(title); }, found);
+
+        // Enough linear lookups to take about as long as walking ten
+        // million nodes
+        size_t linear_lookups = max<size_t>(10, 10000000 / num_records);
+        linear_ns = time_lookups(titles, linear_lookups,
+            [&](const string& title) {
+                auto it = lower_bound(lib.begin(), lib.end(), string_view(title), Title_compare());
+                return it != lib.end() && (*it)->get_title() == title;
+            },
+            found);
+    }
+
+    printf("%9zu records: find_title %8.1f ns/lookup, std::lower_bound %12.1f ns/lookup, %.0fx (%zu found)\n",
+        num_records, set_ns, linear_ns, linear_ns / set_ns, found);
+}
+
+}  // namespace
+
+int main()
+{
+    for (size_t num_records : {10000, 100000, 1000000})
+        run(num_records);
+    return 0;
+}
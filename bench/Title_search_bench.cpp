@@ -0,0 +1,127 @@
+/* Case-insensitive title search: each Case_fold_search kernel against the
+path fs took before the kernel, which lower-cased a copy of every title
+with ::tolower and then called std::string::find. Every needle is
+searched for in each of the titles of a synthetic library, one title at a
+time, as the search index checks its candidates, and then in all of the
+titles at once, joined by NUL bytes, as it scans for short needles.
+Every path must count the same matches.
+*/
+
+#include "Bench_util.h"
+#include "Case_fold_search.h"
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+const size_t num_titles = 1000000;
+const char* const needles[] = {"the", "moon house", "return of the king", "qzx"};
+
+struct Kernel_name
+{
+    Case_fold_kernel kernel;
+    const char* name;
+};
+const Kernel_name kernels[] = {
+    {Case_fold_kernel::scalar, "scalar"}, {Case_fold_kernel::sse2, "sse2"}, {Case_fold_kernel::avx2, "avx2"}};
+
+// Print the time a search took and the bytes it covered per second
+void report(const char* path, double seconds, size_t bytes, size_t matches, size_t expected_matches)
+{
+    printf("    %-24s %8.2f ms %7.2f GB/s %8zu matches\n", path, seconds * 1e3, bytes / seconds / 1e9, matches);
+    if (matches != expected_matches) {
+        printf("    %s found %zu matches, expected %zu\n", path, matches, expected_matches);
+        exit(1);
+    }
+}
+
+// Return the number of titles that contain the needle, searched the way
+// fs did before the kernel
+size_t count_by_copy(const vector<string>& titles, const string& needle)
+{
+    size_t matches = 0;
+    for (const string& title : titles) {
+        string lowered(title);
+        transform(lowered.begin(), lowered.end(), lowered.begin(), ::tolower);
+        if (lowered.find(needle) != string::npos)
+            ++matches;
+    }
+    return matches;
+}
+
+// Return the number of titles that contain the needle, each title
+// searched on its own
+size_t count_by_title(Case_fold_kernel kernel, const vector<string>& titles, string_view needle)
+{
+    size_t matches = 0;
+    for (const string& title : titles) {
+        if (find_case_insensitive_with(kernel, title, needle) != string_view::npos)
+            ++matches;
+    }
+    return matches;
+}
+
+// Return the number of titles that contain the needle, found by scanning
+// the titles joined into one buffer
+size_t count_in_buffer(Case_fold_kernel kernel, string_view buffer, string_view needle)
+{
+    size_t matches = 0;
+    size_t pos;
+    while ((pos = find_case_insensitive_with(kernel, buffer, needle)) != string_view::npos) {
+        ++matches;
+        // Go on from the start of the next title
+        size_t next = buffer.find('\0', pos);
+        if (next == string_view::npos)
+            break;
+        buffer.remove_prefix(next + 1);
+    }
+    return matches;
+}
+
+}  // namespace
+
+int main()
+{
+    vector<string> titles = make_titles(num_titles);
+    string buffer;
+    for (const string& title : titles) {
+        buffer += title;
+        buffer += '\0';
+    }
+    printf("%zu titles, %zu bytes; fs uses the %s kernel\n", titles.size(), buffer.size(),
+        kernels[static_cast<int>(chosen_case_fold_kernel())].name);
+
+    for (const char* needle : needles) {
+        printf("  \"%s\"\n", needle);
+
+        Bench_timer copy_timer;
+        size_t expected = count_by_copy(titles, needle);
+        report("tolower copy + find", copy_timer.seconds(), buffer.size(), expected, expected);
+
+        for (const Kernel_name& kernel : kernels) {
+            if (!case_fold_kernel_supported(kernel.kernel))
+                continue;
+            string path = string(kernel.name) + " per title";
+            Bench_timer timer;
+            size_t matches = count_by_title(kernel.kernel, titles, needle);
+            report(path.c_str(), timer.seconds(), buffer.size(), matches, expected);
+        }
+        for (const Kernel_name& kernel : kernels) {
+            if (!case_fold_kernel_supported(kernel.kernel))
+                continue;
+            string path = string(kernel.name) + " whole buffer";
+            Bench_timer timer;
+            size_t matches = count_in_buffer(kernel.kernel, buffer, needle);
+            report(path.c_str(), timer.seconds(), buffer.size(), matches, expected);
+        }
+    }
+    return 0;
+}
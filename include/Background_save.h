@@ -0,0 +1,57 @@
+/* A Background_save writes a snapshot of the Library and Catalog while
+commands keep running. It forks a child process, whose copy of the data
+is frozen at the moment of the fork and shared with the parent until
+either side changes it, and the child saves that copy with save_snapshot,
+so the file is written under a temporary name and renamed into place.
+The parent checks on the child between commands without waiting for it;
+the child sends back the message of any Error through a pipe.
+Only one save runs at a time.
+*/
+
+#ifndef BACKGROUND_SAVE_H
+#define BACKGROUND_SAVE_H
+
+#include "Catalog.h"
+#include "Library.h"
+#include <string>
+#include <sys/types.h>
+
+class Background_save
+{
+public:
+    Background_save()
+        : child(-1)
+        , message_fd(-1)
+    { }
+
+    // Wait for a save that is still running
+    ~Background_save();
+
+    Background_save(const Background_save&) = delete;
+    Background_save& operator=(const Background_save&) = delete;
+
+    // Start saving the Library and Catalog to the named file. Throw an
+    // Error if a save is already running or the child cannot be started.
+    void start(const std::string& file_name_, const Library& lib, const Catalog& cat);
+
+    // Return a line reporting how far the running save has got, or how
+    // it ended if it has just finished; return an empty string if no
+    // save has been started since the last report of one ending.
+    std::string check();
+
+    bool is_running() const
+    {
+        return child >= 0;
+    }
+
+private:
+    // Collect the finished child and return the report on how it ended
+    std::string finish(int status);
+
+    std::string file_name;
+    pid_t child;
+    // The read end of the pipe the child sends an Error message through
+    int message_fd;
+};
+
+#endif
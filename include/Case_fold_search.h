@@ -0,0 +1,39 @@
+/* Case-insensitive substring search over text in place.
+ASCII letters are compared without regard to case; other bytes must match
+exactly. On x86-64 the search runs 16 bytes at a time with SSE2, or 32
+bytes at a time with AVX2 when the processor supports it; the choice is
+made once at run time. Other platforms use a scalar loop. Each kernel can
+also be asked for by name, so that they can be compared.
+*/
+
+#ifndef CASE_FOLD_SEARCH_H
+#define CASE_FOLD_SEARCH_H
+
+#include <cstddef>
+#include <string_view>
+
+// Return the position of the first occurrence of the needle in the
+// haystack, or std::string_view::npos if there is none. The needle must
+// already be lower case.
+std::size_t find_case_insensitive(std::string_view haystack, std::string_view lowered_needle);
+
+// The kernels the search can run on, from narrowest to widest
+enum class Case_fold_kernel
+{
+    scalar,
+    sse2,
+    avx2
+};
+
+// Return the kernel find_case_insensitive runs on
+Case_fold_kernel chosen_case_fold_kernel();
+
+// Return true if the processor can run the kernel
+bool case_fold_kernel_supported(Case_fold_kernel kernel);
+
+// Search as find_case_insensitive does, on the given kernel, which must
+// be supported.
+std::size_t find_case_insensitive_with(
+    Case_fold_kernel kernel, std::string_view haystack, std::string_view lowered_needle);
+
+#endif
@@ -0,0 +1,157 @@
+/* The Catalog holds all of the Collections, ordered by name. Each
+Collection is stored in its own node, so finding, adding, and removing
+one takes logarithmic time and does not move any other Collection:
+a reference to a Collection stays valid until that Collection is removed.
+When a Collection is removed its members' memberships are released in
+the Library.
+*/
+
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include "Collection.h"
+#include "Library.h"
+#include "Memory_usage.h"
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <string>
+#include <string_view>
+
+class Catalog
+{
+    using Cat_map_t = std::map<std::string, Collection, std::less<>,
+        Counting_allocator<std::pair<const std::string, Collection>, Memory_category::catalog>>;
+
+public:
+    // Iterator over the Collections in alphabetical order of name
+    template <typename Map_iter, typename Value>
+    class Iterator
+    {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = Collection;
+        using difference_type = std::ptrdiff_t;
+        using pointer = Value*;
+        using reference = Value&;
+
+        Iterator(Map_iter it_)
+            : it(it_)
+        { }
+        reference operator*() const
+        {
+            return it->second;
+        }
+        pointer operator->() const
+        {
+            return &it->second;
+        }
+        Iterator& operator++()
+        {
+            ++it;
+            return *this;
+        }
+        Iterator operator++(int)
+        {
+            Iterator temp = *this;
+            ++it;
+            return temp;
+        }
+        Iterator& operator--()
+        {
+            --it;
+            return *this;
+        }
+        Iterator operator--(int)
+        {
+            Iterator temp = *this;
+            --it;
+            return temp;
+        }
+        bool operator==(const Iterator& other) const
+        {
+            return it == other.it;
+        }
+        bool operator!=(const Iterator& other) const
+        {
+            return it != other.it;
+        }
+
+    private:
+        Map_iter it;
+    };
+
+    using iterator = Iterator<Cat_map_t::iterator, Collection>;
+    using const_iterator = Iterator<Cat_map_t::const_iterator, const Collection>;
+
+    Catalog() = default;
+
+    // A moved-from Catalog is left empty. Moving into a Catalog is not
+    // allowed, since its Collections' memberships must be released in
+    // their Library first.
+    Catalog(Catalog&& other);
+    Catalog& operator=(Catalog&& other) = delete;
+    Catalog(const Catalog&) = delete;
+    Catalog& operator=(const Catalog&) = delete;
+
+    // Return the Collection with the given name, or nullptr if there is none.
+    Collection* find(std::string_view name);
+    const Collection* find(std::string_view name) const;
+
+    // Add an empty Collection with the given name, or the given Collection,
+    // whose memberships are counted in the Library. Return the Collection
+    // in the Catalog, or nullptr if the name is taken; a given Collection
+    // then releases its memberships.
+    Collection* add(const std::string& name);
+    Collection* add(Collection&& collection, Library& lib);
+
+    // Release the Collection's memberships and remove it from the Catalog.
+    void remove(Collection& collection, Library& lib);
+
+    // Release all memberships and remove every Collection.
+    void clear(Library& lib);
+
+    void swap(Catalog& other);
+
+    // Accessors
+    bool empty() const
+    {
+        return collections.empty();
+    }
+    int size() const
+    {
+        return collections.size();
+    }
+
+    iterator begin()
+    {
+        return collections.begin();
+    }
+    iterator end()
+    {
+        return collections.end();
+    }
+    const_iterator begin() const
+    {
+        return collections.cbegin();
+    }
+    const_iterator end() const
+    {
+        return collections.cend();
+    }
+    const_iterator cbegin() const
+    {
+        return collections.cbegin();
+    }
+    const_iterator cend() const
+    {
+        return collections.cend();
+    }
+
+private:
+    // Collections keyed by their names
+    Cat_map_t collections;
+};
+
+#endif
@@ -1,15 +1,29 @@
 /* Collections contain a name and a container of members,
-represented as pointers to Records.
-Collection objects manage their own Record container.
-The container of Records is not available to clients.
+represented by the ID numbers of their Records in a compact Member_set.
+Collection objects manage their own member container.
+The container of members is not available to clients.
+Members are looked up by ID; the title order used for printing and
+saving is worked out with the Library only when it is needed, so a
+Record's title can change without touching its Collections. A Collection
+holding a good share of the Library is printed by walking the Library's
+own title order and skipping the Records that are not members, which
+allocates nothing; a smaller one sorts its members by title instead,
+which allocates a pointer per member but does not visit the whole Library.
+Every change to the members is reported to the Library that owns
+the Records, so it can keep its membership counts up to date.
+For the same reason a Collection cannot be copied implicitly, since
+the copy's members would go uncounted; it can be moved, and copied
+only by naming the Library the copy's memberships are counted in.
 */
 
 #ifndef COLLECTION_H
 #define COLLECTION_H
 
+#include "Library.h"
+#include "Member_set.h"
 #include "Utility.h"
-#include <set>
 #include <string>
+#include <vector>
 
 class Collection
 {
@@ -20,42 +34,62 @@ public:
         name = name_;
     }
 
-    /* Construct a Collection from an input file stream in save format,
-    using the record list, restoring all the Record information.
-    Record list is needed to resolve references to record members.
-    No check made for whether the Collection already exists or not.
-    Throw Error exception if invalid data discovered in file.
-    String data input is read directly into the member variable. */
-    Collection(std::ifstream& is, const Lib_ti_t& lib_ti);
+    // Construct a Collection with the given name whose members are the
+    // Records with the given IDs, which must be in the Library. A repeated
+    // ID is counted once.
+    Collection(std::string name_, const std::vector<int>& member_ids, Library& lib);
+
+    // Construct a Collection with the given name and the same members
+    // as the original.
+    Collection(const Collection& original, std::string name_, Library& lib);
 
     // Construct a Collection by combining Collections c1 and c2 and
     // the given name.
-    Collection(const Collection& c1, const Collection& c2, std::string name_);
+    Collection(const Collection& c1, const Collection& c2, std::string name_, Library& lib);
+
+    // Return a Collection with the given name whose members are those in
+    // both c1 and c2, or in c1 but not in c2.
+    static Collection intersect(const Collection& c1, const Collection& c2, std::string name_, Library& lib);
+    static Collection subtract(const Collection& c1, const Collection& c2, std::string name_, Library& lib);
+
+    // Return a Collection with the given name whose members are those in
+    // any of the given Collections. There must be at least one.
+    static Collection combine_all(
+        const std::vector<const Collection*>& collections, std::string name_, Library& lib);
+
+    // Moving a Collection hands its members over without counting them again
+    Collection(Collection&&) = default;
+    Collection& operator=(Collection&&) = default;
+    Collection(const Collection&) = delete;
+    Collection& operator=(const Collection&) = delete;
 
-    // Add the Record, throw exception if there is already a Record
-    // with the same title.
-    void add_member(Record* record_ptr);
+    // Add the Record, throw exception if the Record is already a member.
+    void add_member(Record* record_ptr, Library& lib);
 
     // Return true if the record is present, false if not.
     bool is_member_present(Record* record_ptr) const;
 
     // Remove the specified Record, throw exception if the record was not found.
-    void remove_member(Record* record_ptr);
-
-    // Remove old_record in the member_list and insert new_record
-    // into the member_list.
-    void remove_then_add_member(Record* old_record, Record* new_record);
+    void remove_member(Record* record_ptr, Library& lib);
 
     // discard all members
-    void clear()
+    void clear(Library& lib);
+
+    // Write a Collections's data to a stream in save format, one line
+    // per member in alphabetical order of title.
+    void save(std::ostream& os, const Library& lib) const;
+
+    // Print the Collection data, with the members in alphabetical
+    // order of title.
+    void print(std::ostream& os, const Library& lib) const;
+
+    // Call func with each member's Record ID in ascending order
+    template <typename F>
+    void for_each_member_id(F func) const
     {
-        member_list.clear();
+        member_list.for_each([&](uint32_t id) { func(static_cast<int>(id)); });
     }
 
-    // Write a Collections's data to a stream in save format, with endl as
-    // specified.
-    void save(std::ostream& os) const;
-
     // Accessors
     const std::string& get_name() const
     {
@@ -70,14 +104,16 @@ public:
         return member_list.size();
     }
 
-    friend std::ostream& operator<<(std::ostream& os, const Collection& collection);
-
 private:
-    Lib_ti_t member_list;
-    std::string name;
-};
+    // Construct a Collection with the given members and count their
+    // memberships
+    Collection(Member_set members, std::string name_, Library& lib);
 
-// Print the Collection data
-std::ostream& operator<<(std::ostream& os, const Collection& collection);
+    // Call func with each member Record in alphabetical order of title
+    template <typename F>
+    void for_each_member_by_title(const Library& lib, F func) const;
 
+    Member_set member_list;
+    std::string name;
+};
 #endif
\ No newline at end of file
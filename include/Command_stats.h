@@ -0,0 +1,72 @@
+/* Command_stats counts, for each command in a Command_table, how many
+times it ran, how many of those ended in an Error or a Title_error, and
+how long they took, so the slow commands of a long run can be found.
+The times go into a log-linear histogram, as in HDR histograms: below 16
+nanoseconds each nanosecond has its own bucket, and each power of two
+above that is split into 16 buckets, so a percentile read from the
+histogram is within one sixteenth of the true time. All counters are
+atomic and fixed in size, so recording a command takes a few relaxed
+increments and no allocation, and the server's clients record at once.
+Printing the statistics also resets them. A command recorded at the same
+moment may be counted in either period, or partly in each.
+*/
+
+#ifndef COMMAND_STATS_H
+#define COMMAND_STATS_H
+
+#include "Command_table.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+
+class Command_stats
+{
+public:
+    enum class Outcome { done, error, title_error };
+
+    // Make counters for each command in the table
+    explicit Command_stats(const Command_table& commands_);
+
+    // Count a run of the command with the index, with how it ended and
+    // how long it took
+    void record(int index, Outcome outcome, std::chrono::nanoseconds elapsed);
+
+    // Count an unrecognized command
+    void record_unrecognized()
+    {
+        num_unrecognized.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Print the counts and the 50th, 90th and 99th percentile and the
+    // longest time of each command that ran, then reset the counters.
+    void print_and_reset(std::ostream& os);
+
+    // The histogram's shape: times up to 2 to the power max_exponent + 1
+    // nanoseconds have buckets of their own, and longer ones share the
+    // last bucket
+    static const int sub_buckets = 16;
+    static const int max_exponent = 47;
+    static const int num_buckets = (max_exponent - 2) * sub_buckets;
+
+    // Return the bucket of the time, and the longest time in a bucket
+    static int bucket_of(std::uint64_t nanoseconds);
+    static std::uint64_t bucket_top(int bucket);
+
+private:
+    struct Counters
+    {
+        std::atomic<std::uint64_t> num_runs{0};
+        std::atomic<std::uint64_t> num_errors{0};
+        std::atomic<std::uint64_t> num_title_errors{0};
+        std::atomic<std::uint64_t> max_nanoseconds{0};
+        std::atomic<std::uint64_t> buckets[num_buckets] = {};
+    };
+
+    const Command_table& commands;
+    std::unique_ptr<Counters[]> counters;
+    std::atomic<std::uint64_t> num_unrecognized;
+};
+
+#endif
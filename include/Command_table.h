@@ -0,0 +1,61 @@
+/* A Command_table finds the function for a two-letter command. It has a
+slot for every pair of letters, indexed by the letters themselves, so a
+lookup is a little arithmetic and one load instead of building a string
+and searching a map. Characters other than letters name no command.
+Each command also has an index, its place in the list the table was
+made from, by which other tables can keep data about it.
+*/
+
+#ifndef COMMAND_TABLE_H
+#define COMMAND_TABLE_H
+
+#include "Catalog.h"
+#include "Library.h"
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <utility>
+#include <vector>
+
+class Command_table
+{
+public:
+    using Command = std::function<void(Library&, Catalog&)>;
+
+    // Fill the table from pairs of a two-letter name and its function
+    Command_table(std::initializer_list<std::pair<const char*, Command>> commands);
+
+    // Return the command named by the two characters, or nullptr if
+    // there is none.
+    const Command* find(char first, char second) const;
+
+    // Return the index of the command named by the two characters, or
+    // -1 if there is none.
+    int find_index(char first, char second) const;
+
+    // Return the name of the command with the index
+    const std::string& get_name(int index) const
+    {
+        return names[index];
+    }
+
+    // Return the number of commands
+    int size() const
+    {
+        return static_cast<int>(names.size());
+    }
+
+private:
+    // Return the letter's place among the lower-case and then the
+    // upper-case letters, or -1 if it is not a letter.
+    static int letter_index(char c);
+
+    // Return the slot of the two characters, or -1 if either is not a letter
+    static int slot_index(char first, char second);
+
+    std::vector<Command> slots;
+    std::vector<int> slot_commands;
+    std::vector<std::string> names;
+};
+
+#endif
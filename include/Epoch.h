@@ -0,0 +1,50 @@
+/* Epoch-based reclamation of memory that lock-free readers may still see.
+A reader holds an Epoch_guard while it uses published data; entering one
+is a single store to the thread's own slot, and never waits for a writer.
+A writer that replaces published data retires the old memory, and after
+it publishes the replacement it calls reclaim_retired. Memory retired up
+to then is stamped with the current epoch and the epoch moves on, so a
+reader that enters later can only find the replacement. The memory is
+freed once every reader that was inside a guard when it was stamped has
+left it.
+Writers must be serialized with each other; only readers run alongside.
+*/
+
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include <cstdint>
+
+class Epoch_guard
+{
+public:
+    // Enter the current epoch; guards on one thread may nest
+    Epoch_guard();
+
+    // Leave the epoch, unless an outer guard on this thread remains
+    ~Epoch_guard();
+
+    Epoch_guard(const Epoch_guard&) = delete;
+    Epoch_guard& operator=(const Epoch_guard&) = delete;
+};
+
+// Hand over memory that readers may still see, to be freed with the
+// deleter once none can.
+void retire(void* ptr, void (*deleter)(void*));
+
+template <typename T>
+void retire(T* ptr)
+{
+    retire(const_cast<void*>(static_cast<const void*>(ptr)), [](void* p) { delete static_cast<T*>(p); });
+}
+
+// Called after a writer publishes new data. Stamp the memory retired
+// since the last call with the current epoch, move to the next epoch,
+// and free what no reader can still see.
+void reclaim_retired();
+
+// Return the current epoch. Memory a writer made in the current epoch
+// has not been published yet, so the writer may still change it in place.
+std::uint64_t get_epoch();
+
+#endif
@@ -0,0 +1,237 @@
+/* An Id_table maps Record ID numbers to values.
+Record IDs are handed out densely from a counter, so most
+IDs index a table of slots directly, and a slot holding a
+value-initialized T is unused. A file may hold IDs far beyond the number
+of Records, and a table sized by the largest of them would be huge. The
+table therefore grows only while at least a quarter of its slots would
+be in use, and an ID beyond it goes into an ordered overflow map instead.
+Once enough values are in the table for it to reach an ID in the
+overflow, it grows over that ID and the value moves into its slot.
+Every ID in the overflow is past the end of the table, so iteration
+visits the table and then the overflow, in ascending ID order.
+The table's memory is counted in the given category; see Memory_usage.h.
+*/
+
+#ifndef ID_TABLE_H
+#define ID_TABLE_H
+
+#include "Memory_usage.h"
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <utility>
+#include <vector>
+
+template <typename T, Memory_category category>
+class Id_table
+{
+    using Slots_t = std::vector<T, Counting_allocator<T, category>>;
+    using Overflow_t = std::map<int, T, std::less<int>, Counting_allocator<std::pair<const int, T>, category>>;
+
+public:
+    // Forward iterator over the values in ascending ID order
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const_iterator(typename Slots_t::const_iterator slot_it_, typename Slots_t::const_iterator slots_end_,
+            typename Overflow_t::const_iterator overflow_it_)
+            : slot_it(slot_it_)
+            , slots_end(slots_end_)
+            , overflow_it(overflow_it_)
+        {
+            skip_unused();
+        }
+
+        reference operator*() const
+        {
+            return slot_it != slots_end ? *slot_it : overflow_it->second;
+        }
+        pointer operator->() const
+        {
+            return &**this;
+        }
+        const_iterator& operator++()
+        {
+            if (slot_it != slots_end) {
+                ++slot_it;
+                skip_unused();
+            } else
+                ++overflow_it;
+            return *this;
+        }
+        const_iterator operator++(int)
+        {
+            const_iterator temp = *this;
+            ++*this;
+            return temp;
+        }
+        bool operator==(const const_iterator& other) const
+        {
+            return slot_it == other.slot_it && overflow_it == other.overflow_it;
+        }
+        bool operator!=(const const_iterator& other) const
+        {
+            return !(*this == other);
+        }
+
+    private:
+        void skip_unused()
+        {
+            while (slot_it != slots_end && is_unused(*slot_it))
+                ++slot_it;
+        }
+
+        typename Slots_t::const_iterator slot_it;
+        typename Slots_t::const_iterator slots_end;
+        typename Overflow_t::const_iterator overflow_it;
+    };
+
+    Id_table()
+        : num_values(0)
+    { }
+
+    // A moved-from table is left empty
+    Id_table(Id_table&& other)
+        : num_values(0)
+    {
+        swap(other);
+    }
+    Id_table& operator=(Id_table&& other)
+    {
+        clear();
+        swap(other);
+        return *this;
+    }
+
+    // Put the value in the place for the ID. Return false, and leave the
+    // table unchanged, if the ID is not positive or already has a value.
+    bool insert(int id, const T& value)
+    {
+        if (id < 1 || find(id) != nullptr)
+            return false;
+
+        if (static_cast<std::size_t>(id) >= slots.size() && static_cast<std::size_t>(id) < dense_limit())
+            grow(static_cast<std::size_t>(id) + 1);
+        if (static_cast<std::size_t>(id) < slots.size())
+            slots[id] = value;
+        else
+            overflow.emplace(id, value);
+        ++num_values;
+
+        // IDs put in the overflow while the table was sparse move into it
+        // once there are values enough to fill it
+        if (!overflow.empty() && static_cast<std::size_t>(overflow.begin()->first) < dense_limit())
+            grow(static_cast<std::size_t>(overflow.begin()->first) + 1);
+        return true;
+    }
+
+    // Return the value for the ID, or nullptr if there is none.
+    const T* find(int id) const
+    {
+        if (id < 1)
+            return nullptr;
+        if (static_cast<std::size_t>(id) < slots.size())
+            return is_unused(slots[id]) ? nullptr : &slots[id];
+        if (overflow.empty())
+            return nullptr;
+        auto it = overflow.find(id);
+        return it == overflow.end() ? nullptr : &it->second;
+    }
+    T* find(int id)
+    {
+        return const_cast<T*>(static_cast<const Id_table*>(this)->find(id));
+    }
+
+    // Remove the value for the ID, if there is one.
+    void erase(int id)
+    {
+        T* value_ptr = find(id);
+        if (value_ptr == nullptr)
+            return;
+        if (static_cast<std::size_t>(id) < slots.size())
+            *value_ptr = T();
+        else
+            overflow.erase(id);
+        --num_values;
+    }
+
+    // Remove every value
+    void clear()
+    {
+        slots.clear();
+        overflow.clear();
+        num_values = 0;
+    }
+
+    // Exchange contents with another table
+    void swap(Id_table& other)
+    {
+        slots.swap(other.slots);
+        overflow.swap(other.overflow);
+        std::swap(num_values, other.num_values);
+    }
+
+    // Accessors
+    bool empty() const
+    {
+        return num_values == 0;
+    }
+    int size() const
+    {
+        return num_values;
+    }
+    const_iterator begin() const
+    {
+        return const_iterator(slots.cbegin(), slots.cend(), overflow.cbegin());
+    }
+    const_iterator end() const
+    {
+        return const_iterator(slots.cend(), slots.cend(), overflow.cend());
+    }
+
+private:
+    // The table may grow to cover this many IDs however few values it holds
+    static constexpr std::size_t min_slots = 1024;
+
+    static bool is_unused(const T& value)
+    {
+        return value == T();
+    }
+
+    // Return the size the table may grow to while a quarter of it, with
+    // one more value, would be in use
+    std::size_t dense_limit() const
+    {
+        return std::max(min_slots, 4 * (static_cast<std::size_t>(num_values) + 1));
+    }
+
+    // Grow the table to the size, moving the values of the IDs it now
+    // covers out of the overflow
+    void grow(std::size_t size)
+    {
+        slots.resize(size);
+        auto overflow_end = size > static_cast<std::size_t>(std::numeric_limits<int>::max())
+            ? overflow.end()
+            : overflow.lower_bound(static_cast<int>(size));
+        for (auto it = overflow.begin(); it != overflow_end; ++it)
+            slots[it->first] = it->second;
+        overflow.erase(overflow.begin(), overflow_end);
+    }
+
+    // slots[id] holds the value for that ID; slot 0 is never used
+    Slots_t slots;
+    // The values of IDs past the end of the table
+    Overflow_t overflow;
+    int num_values;
+};
+
+#endif
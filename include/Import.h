@@ -0,0 +1,35 @@
+/* Bulk import of Records from a CSV or TSV file for the iL command.
+Each line of the file is one Record:
+
+    medium,title[,rating]
+
+with the fields separated by tabs instead of commas when the file name
+ends in ".tsv". A CSV field may be enclosed in double quotes, so that
+it can hold commas, with a doubled quote standing for a quote. The
+medium may not contain whitespace, the title is cleaned up the same way
+as a title that is typed in, and the rating, if present, is between 1
+and 5. Blank lines are skipped, and so is a first line that reads as a
+header naming the fields.
+The whole file is mapped into memory and parsed before any Record is
+added, so an invalid row leaves the Library unchanged; the rows are then
+added to the Library's indexes in bulk.
+*/
+
+#ifndef IMPORT_H
+#define IMPORT_H
+
+#include "Library.h"
+#include <string>
+
+struct Import_result
+{
+    int num_added;
+    // Rows whose title was already in the Library or in an earlier row
+    int num_duplicate;
+};
+
+// Import the Records in the named file into the Library. Throw an Error
+// if the file cannot be opened or a row is invalid.
+Import_result import_records(const std::string& file_name, Library& lib);
+
+#endif
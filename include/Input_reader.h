@@ -0,0 +1,75 @@
+/* An Input_reader splits the commands typed or piped in into characters,
+words, integers and lines. It reads its file in large blocks into one
+buffer and hands out string_views into that buffer, so nothing is copied
+until a command decides to keep it. A view stays valid only until the
+next read, which may move the buffer's contents to make room for more.
+Whitespace is skipped before a character, word or integer, as with the
+>> operator; a line is everything up to the next newline, as with getline.
+A reader can also be given its text directly, as when journaled changes
+are replayed.
+*/
+
+#ifndef INPUT_READER_H
+#define INPUT_READER_H
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+class Input_reader
+{
+public:
+    // Read from the open file descriptor
+    explicit Input_reader(int fd_);
+
+    // Read the given text only
+    explicit Input_reader(std::string_view text);
+
+    Input_reader(const Input_reader&) = delete;
+    Input_reader& operator=(const Input_reader&) = delete;
+
+    // Read the next non-whitespace character. Return false at the end
+    // of the input.
+    bool read_char(char& c);
+
+    // Read the next run of non-whitespace characters. Return an empty
+    // view at the end of the input.
+    std::string_view read_word();
+
+    // Read an optionally signed decimal integer after any whitespace.
+    // Return false, consuming nothing more, if there is none or it does
+    // not fit in an int.
+    bool read_int(int& value);
+
+    // Read the rest of the current line and move past its newline
+    std::string_view read_line();
+
+    // Discard the rest of the current line and its newline
+    void skip_line();
+
+    // Skip the whitespace already read in and return true if more input
+    // is waiting in the buffer, so that reading it will not block.
+    bool has_buffered_input();
+
+private:
+    // Skip whitespace, reading more input as needed
+    void skip_white();
+
+    // Return the length of the run of characters from the current
+    // position for which pred is true, reading more input as needed
+    template <typename P>
+    std::size_t scan(P pred);
+
+    // Move the unread input to the front of the buffer, growing it if it
+    // is full, and read more after it. Return false if there is no more.
+    bool fill();
+
+    int fd;
+    bool at_eof;
+    std::vector<char> buffer;
+    // The unread input is buffer[pos, end)
+    std::size_t pos;
+    std::size_t end;
+};
+
+#endif
@@ -0,0 +1,90 @@
+/* A Journal makes the Library and Catalog durable without rewriting them
+after every change. It keeps two files: a checkpoint, which is a binary
+snapshot of the whole Library and Catalog, and the journal itself, which
+lists every change made since that checkpoint as the command that makes
+it, such as "am favorites 12". Every line carries a checksum of its
+text. The first line names the checkpoint by its checksum and records
+the next Record ID, which a snapshot does not hold.
+Changes are appended to a buffer and written with a single fsync for
+the whole group, once the group is large enough or there is no more
+input waiting to be read. After a number of changes a new checkpoint is
+taken and the journal starts over.
+Recovery loads the checkpoint the journal names and hands back the
+changes to be replayed on top of it. A line cut short by a crash, and
+everything after it, is dropped.
+A checkpoint is written to temporary files that are renamed into place,
+the new journal first, so a crash at any point leaves a journal whose
+checkpoint can be found: either the old pair, or the new journal with
+the new checkpoint still under its temporary name.
+*/
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "Catalog.h"
+#include "Library.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Journal
+{
+public:
+    // The checkpoint is kept next to the journal, in the file with the
+    // journal's name followed by ".checkpoint". Nothing is opened until
+    // recover is called.
+    Journal(const std::string& file_name_);
+
+    // Write any changes still in the buffer
+    ~Journal();
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    // Load the latest checkpoint into the given empty Library and Catalog
+    // and return the changes made since, in order, for the caller to
+    // replay. If there is no journal yet, start one with a checkpoint of
+    // the empty Library and Catalog. Throw an Error if a file cannot be
+    // opened or written, or the journal's checkpoint cannot be found.
+    std::vector<std::string> recover(Library& lib, Catalog& cat);
+
+    // Add a change to the buffer
+    void append(const std::string& change);
+
+    // Called after each command; writes and syncs the buffer unless more
+    // input is waiting and the group is still small. Throw an Error if
+    // the journal cannot be written.
+    void end_command(bool more_input);
+
+    // Write and sync the buffered changes. Throw an Error if the journal
+    // cannot be written.
+    void sync();
+
+    // Return true once enough changes have been made since the last
+    // checkpoint that it is time for another.
+    bool is_checkpoint_due() const;
+
+    // Write a checkpoint of the Library and Catalog and start a new,
+    // empty journal. Throw an Error if a file cannot be written; the
+    // previous checkpoint and journal are then still in place.
+    void checkpoint(const Library& lib, const Catalog& cat);
+
+private:
+    // Load the checkpoint with the checksum into the empty Library and
+    // Catalog. Return false, leaving them empty, if the file is missing,
+    // invalid, or a different checkpoint.
+    bool load_checkpoint(const std::string& name, uint64_t checksum, Library& lib, Catalog& cat);
+
+    // Open the journal for appending
+    void open_for_append();
+
+    std::string file_name;
+    std::string checkpoint_name;
+    int fd;
+    // Lines appended but not yet written
+    std::string buffer;
+    int num_buffered;
+    int num_since_checkpoint;
+};
+
+#endif
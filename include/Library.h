@@ -0,0 +1,207 @@
+/* The Library holds all of the individual Records. It keeps them in an
+alphabetical set for title lookups and ordered output, and in an ID slot
+table for lookups by Record ID number, and in a search index for
+substring queries over titles; the rating order lives in the working
+version's trees, described below. The Library owns its Records,
+which are allocated from its Record_arena, and hands out ID numbers for
+new ones.
+It also keeps running counts of how its Records are shared among
+Collections: each Record knows how many Collections it belongs to, and
+the Library knows how many Records belong to at least one and to more
+than one Collection, so these questions are answered without searching
+the Catalog.
+Readers that take no lock see the Library through its published
+Library_version instead. Every change is made to a working version as
+well, and publish makes the working version the one readers see. Memory
+readers may still use, including the arena on clear, is retired rather
+than freed.
+*/
+
+#ifndef LIBRARY_H
+#define LIBRARY_H
+
+#include "Library_version.h"
+#include "Record.h"
+#include "Record_arena.h"
+#include "Record_id_index.h"
+#include "Title_search_index.h"
+#include "Utility.h"
+#include <atomic>
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+// The data of one Record to be added in bulk. The ID number is only
+// used for restored Records; new ones are given the next ID numbers.
+struct Record_row
+{
+    int id;
+    std::string_view medium;
+    std::string_view title;
+    int rating;
+};
+
+class Library
+{
+public:
+    // An empty version is published from the start
+    Library();
+
+    // The Library's Records are released along with its arena as soon as
+    // no reader can see them. A Library that takes its place in the
+    // readers' view must be published first.
+    ~Library();
+
+    // A moved-from Library is left empty
+    Library(Library&& other);
+    Library& operator=(Library&& other);
+    Library(const Library&) = delete;
+    Library& operator=(const Library&) = delete;
+
+    // Return the Record with the given title or ID, or nullptr if there is none.
+    Record* find_title(std::string_view title) const;
+    Record* find_id(int id) const
+    {
+        return lib_id.find(id);
+    }
+
+    // Return the Records whose titles contain the lower-cased string when
+    // lower-cased, in alphabetical order of title.
+    std::vector<Record*> find_containing(std::string_view lowered) const
+    {
+        return lib_search.find(lowered);
+    }
+
+    // Create a Record with the next ID number and add it to the Library.
+    // Return nullptr if a Record with the same title already exists.
+    Record* add_record(std::string_view medium, std::string_view title);
+
+    // Create Records from the rows with the next ID numbers, in the order
+    // of the rows, and add them to the indexes in bulk. A row whose title
+    // is already in the Library, or in an earlier row, is skipped.
+    // Return the Record created for each row, or nullptr if it was skipped.
+    std::vector<Record*> add_records(const std::vector<Record_row>& rows);
+
+    // Add restored Records, which already have ID numbers, to the empty
+    // Library, building its indexes in parallel. Return false, leaving
+    // the Library empty, if an ID is less than 1 or the largest int, or an
+    // ID or title appears twice. The next ID handed out is one past the biggest ID restored.
+    bool restore_records(const std::vector<Record_row>& rows);
+
+    // Give the Record a new rating, keeping the rating order up to date.
+    void set_rating(Record* record_ptr, int rating);
+
+    // Give the Record a new title. Return false if the title is taken.
+    bool retitle_record(Record* record_ptr, std::string_view title);
+
+    // Remove the Record from the Library and delete it.
+    void remove_record(Record* record_ptr);
+
+    // Delete all Records, releasing the whole arena in one step, and
+    // start ID numbers from 1 again.
+    void clear();
+
+    // Count one more or one less Collection that the Record belongs to.
+    // Called by Collection whenever its members change.
+    void add_membership(Record* record_ptr);
+    void remove_membership(Record* record_ptr);
+
+    // Swap the contents, but not the published versions; both Libraries
+    // publish their new contents at the next call to publish.
+    void swap(Library& other);
+
+    // Make the changes since the last call visible to readers by
+    // publishing a new version, if there were any.
+    void publish();
+
+    // Return the version most recently published. The caller must hold
+    // an Epoch_guard for as long as it uses the version.
+    const Library_version& get_version() const
+    {
+        return *published.load();
+    }
+
+    // Accessors
+    bool empty() const
+    {
+        return lib_ti.empty();
+    }
+    int size() const
+    {
+        return lib_ti.size();
+    }
+    int get_next_id() const
+    {
+        return next_id;
+    }
+    // The ID must be greater than the ID of every Record in the Library
+    void set_next_id(int id)
+    {
+        next_id = id;
+    }
+    int get_total_memberships() const
+    {
+        return total_memberships;
+    }
+    int get_num_in_at_least_one() const
+    {
+        return num_in_at_least_one;
+    }
+    int get_num_in_more_than_one() const
+    {
+        return num_in_more_than_one;
+    }
+    std::size_t get_arena_bytes_reserved() const
+    {
+        return arena.get_bytes_reserved();
+    }
+    std::size_t get_arena_bytes_used() const
+    {
+        return arena.get_bytes_used();
+    }
+
+    // Iterate over the Records in alphabetical order of title
+    Lib_ti_t::const_iterator begin() const
+    {
+        return lib_ti.cbegin();
+    }
+    Lib_ti_t::const_iterator end() const
+    {
+        return lib_ti.cend();
+    }
+
+private:
+    // std::set of Record pointers arranged
+    // by an alphabetical order
+    Lib_ti_t lib_ti;
+
+    // Slot table of Record pointers indexed
+    // by ID
+    Record_id_index lib_id;
+
+    // Lower-cased titles and their trigrams
+    Title_search_index lib_search;
+
+    // Memory of the Records and their strings
+    Record_arena arena;
+
+    // Rebuild the working version's trees from the title order
+    void rebuild_version();
+
+    // Publish if many titles were freed since the last publication
+    void publish_if_many_freed();
+
+    // The version being changed, and the one readers see
+    Library_version working;
+    std::atomic<const Library_version*> published;
+    bool is_changed;
+
+    int next_id;
+
+    // Running membership counters
+    int total_memberships;
+    int num_in_at_least_one;
+    int num_in_more_than_one;
+};
+
+#endif
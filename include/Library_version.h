@@ -0,0 +1,180 @@
+/* A Library_version is the state of a Library's Records at one moment,
+published for readers that take no lock. It is never changed once it is
+published; the Library builds the next version from a working copy and
+publishes that in its place.
+Each Record appears as a Record_entry, a copy of the Record's data that
+also never changes. The entries are kept in one Entry_tree for each
+rating, in alphabetical order of title, so the rating order is the trees
+one after another from the highest rating down, and the title order is
+a merge of the trees.
+An Entry_tree is a B+-tree whose copies share their nodes. A change
+copies the nodes on the path to the entry it changes and retires the old
+ones, to be freed by epoch-based reclamation once no reader can see
+them; nodes made since the last version was published are changed in
+place. The titles and media the entries point to stay in the Library's
+arena, which is also retired rather than freed while readers may see it.
+*/
+
+#ifndef LIBRARY_VERSION_H
+#define LIBRARY_VERSION_H
+
+#include "Record.h"
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// The data of a Record at one moment
+struct Record_entry
+{
+    int id;
+    int rating;
+    const std::string* medium;
+    std::string_view title;
+};
+
+// Return the entry for the Record's current data
+inline Record_entry make_entry(const Record* record_ptr)
+{
+    return Record_entry{record_ptr->get_ID(), record_ptr->get_rating(), &record_ptr->get_medium(),
+        record_ptr->get_title()};
+}
+
+// Print the entry in the same form as its Record
+std::ostream& operator<<(std::ostream& os, const Record_entry& entry);
+
+class Entry_tree
+{
+public:
+    // The nodes are defined with the tree's operations
+    struct Node;
+    struct Leaf;
+    struct Inner;
+
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Record_entry;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Record_entry*;
+        using reference = const Record_entry&;
+
+        const Record_entry& operator*() const
+        {
+            return *pos;
+        }
+        const Record_entry* operator->() const
+        {
+            return pos;
+        }
+        const_iterator& operator++()
+        {
+            if (++pos == leaf_end)
+                next_leaf();
+            return *this;
+        }
+        bool operator==(const const_iterator& other) const
+        {
+            return pos == other.pos;
+        }
+        bool operator!=(const const_iterator& other) const
+        {
+            return pos != other.pos;
+        }
+
+    private:
+        friend class Entry_tree;
+
+        // Move to the first entry of the leftmost leaf under the node
+        void descend(const Node* node);
+
+        // Move to the first entry of the next leaf, or to the end
+        void next_leaf();
+
+        // The inner nodes above the current leaf, with the place of the
+        // child being visited in each
+        std::vector<std::pair<const Inner*, int>> path;
+        const Record_entry* pos = nullptr;
+        const Record_entry* leaf_end = nullptr;
+    };
+
+    // Copies share their nodes; only the copy a Library is working on
+    // is ever changed.
+    Entry_tree()
+        : root(nullptr)
+        , num_entries(0)
+    { }
+
+    // Add the entry, whose title must not be in the tree
+    void insert(const Record_entry& entry);
+
+    // Remove the entry with the title, if there is one
+    void erase(std::string_view title);
+
+    // Replace the contents with the entries, which are in title order
+    void assign(const std::vector<Record_entry>& sorted);
+
+    // Remove all of the entries, retiring every node
+    void clear();
+
+    std::size_t size() const
+    {
+        return num_entries;
+    }
+
+    const_iterator begin() const;
+    const_iterator end() const
+    {
+        return const_iterator();
+    }
+
+private:
+    Node* root;
+    std::size_t num_entries;
+};
+
+struct Library_version
+{
+    static const int num_ratings = 6;
+
+    // Call func on each entry in alphabetical order of title, merging
+    // the trees of the different ratings
+    template <typename F>
+    void for_each_by_title(F func) const;
+
+    // The entries with each rating from 0 to 5
+    Entry_tree by_rating[num_ratings];
+
+    int size = 0;
+    int total_memberships = 0;
+    int num_in_at_least_one = 0;
+    int num_in_more_than_one = 0;
+};
+
+template <typename F>
+void Library_version::for_each_by_title(F func) const
+{
+    Entry_tree::const_iterator iters[num_ratings];
+    for (int rating = 0; rating < num_ratings; ++rating)
+        iters[rating] = by_rating[rating].begin();
+
+    const Entry_tree::const_iterator end;
+    while (true) {
+        int first = -1;
+        for (int rating = 0; rating < num_ratings; ++rating) {
+            if (iters[rating] != end && (first < 0 || iters[rating]->title < iters[first]->title))
+                first = rating;
+        }
+        if (first < 0)
+            return;
+        func(*iters[first]);
+        ++iters[first];
+    }
+}
+
+#endif
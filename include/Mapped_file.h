@@ -0,0 +1,35 @@
+/* A Mapped_file maps a whole file into memory for reading, so that its
+contents can be parsed in place without copying them into a buffer.
+The mapping is removed when the Mapped_file is destroyed.
+*/
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+class Mapped_file
+{
+public:
+    // Throw an Error if the file cannot be opened or mapped, or is empty
+    Mapped_file(const std::string& file_name);
+    ~Mapped_file();
+    Mapped_file(const Mapped_file&) = delete;
+    Mapped_file& operator=(const Mapped_file&) = delete;
+
+    const char* begin() const
+    {
+        return data;
+    }
+    const char* end() const
+    {
+        return data + size;
+    }
+
+private:
+    const char* data;
+    std::size_t size;
+};
+
+#endif
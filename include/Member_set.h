@@ -0,0 +1,150 @@
+/* A Member_set holds the Record ID numbers of a Collection's members.
+Its representation adapts to its size. A small set is a sorted vector of
+32-bit IDs. A large set is compressed in the manner of a roaring bitmap:
+IDs are grouped into chunks by their high 16 bits, and each chunk keeps
+the low 16 bits either as a sorted array while it is sparse, or as a
+bitmap of all 65536 values once it is dense.
+Every operation compares integers only; members are visited in ascending
+order of ID. Union, intersection, and difference walk both sets once in
+order, merging arrays and combining bitmaps a word at a time.
+*/
+
+#ifndef MEMBER_SET_H
+#define MEMBER_SET_H
+
+#include "Memory_usage.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Member_set
+{
+    // The set counts its memory as collection membership
+    template <typename T>
+    using Member_vector = std::vector<T, Counting_allocator<T, Memory_category::members>>;
+
+public:
+    Member_set()
+        : count(0)
+        , compressed(false)
+    { }
+
+    // Add the ID. Return false if it was already present.
+    bool insert(uint32_t id);
+
+    // Remove the ID. Return false if it was not present.
+    bool erase(uint32_t id);
+
+    // Return true if the ID is present.
+    bool contains(uint32_t id) const;
+
+    // Remove every ID and return to the small representation.
+    void clear();
+
+    // Return the IDs in either set, in both sets, or in the first set
+    // but not the second.
+    static Member_set set_union(const Member_set& s1, const Member_set& s2);
+    static Member_set set_intersection(const Member_set& s1, const Member_set& s2);
+    static Member_set set_difference(const Member_set& s1, const Member_set& s2);
+
+    // Call func with each ID in ascending order
+    template <typename F>
+    void for_each(F func) const
+    {
+        if (!compressed) {
+            for (uint32_t id : ids)
+                func(id);
+            return;
+        }
+        for (const Chunk& chunk : chunks)
+            chunk.for_each(func);
+    }
+
+    // Accessors
+    bool empty() const
+    {
+        return count == 0;
+    }
+    int size() const
+    {
+        return count;
+    }
+
+private:
+    // The IDs that share their high 16 bits
+    struct Chunk
+    {
+        explicit Chunk(uint32_t key_)
+            : key(key_)
+            , count(0)
+        { }
+
+        bool insert(uint16_t low);
+        bool erase(uint16_t low);
+        bool contains(uint16_t low) const;
+
+        template <typename F>
+        void for_each(F func) const
+        {
+            uint32_t high = key << 16;
+            if (bitmap.empty()) {
+                for (uint16_t low : array)
+                    func(high | low);
+                return;
+            }
+            for (std::size_t word = 0; word < bitmap.size(); ++word) {
+                for (uint64_t bits = bitmap[word]; bits != 0; bits &= bits - 1)
+                    func(high | static_cast<uint32_t>(word * 64 + __builtin_ctzll(bits)));
+            }
+        }
+
+        // Switch between the array and the bitmap as the chunk fills or empties
+        void to_bitmap();
+        void to_array();
+
+        // Recount a combined chunk and give it the representation that
+        // suits its new count
+        void normalize();
+
+        uint32_t key;
+        int count;
+        // Sorted low bits while the chunk is sparse
+        Member_vector<uint16_t> array;
+        // One bit per low value once the chunk is dense; empty otherwise
+        Member_vector<uint64_t> bitmap;
+    };
+
+    // Switch between the sorted ID vector and the chunks as the set
+    // grows or shrinks
+    void compress();
+    void decompress();
+
+    // Return the sorted IDs of a small set split into chunks
+    Member_vector<Chunk> split_into_chunks() const;
+
+    // Combine two sets with the operation. Small sets are merged as
+    // sorted vectors; otherwise the chunks with the same high bits are
+    // combined, and a chunk present in only one set is kept if the
+    // operation says so.
+    enum class Operation
+    {
+        set_union,
+        set_intersection,
+        set_difference
+    };
+    static Member_set combine(const Member_set& s1, const Member_set& s2, Operation operation);
+    static Chunk combine_chunks(const Chunk& c1, const Chunk& c2, Operation operation);
+
+    // Return the chunk for the high bits, or the place to insert it
+    Member_vector<Chunk>::iterator find_chunk(uint32_t key);
+    Member_vector<Chunk>::const_iterator find_chunk(uint32_t key) const;
+
+    // Sorted IDs while the set is small
+    Member_vector<uint32_t> ids;
+    // Chunks in order of their high bits once the set is large
+    Member_vector<Chunk> chunks;
+    int count;
+    bool compressed;
+};
+
+#endif
@@ -0,0 +1,110 @@
+/* Memory usage counts the heap bytes held by each kind of data in the
+program, so that pa can show where the memory of a large library goes.
+The containers that hold the bulk of the data allocate through a
+Counting_allocator, which adds every allocation to the count of its
+category and takes it off again when it is freed. The nodes of published
+library versions are counted by their own operator new and delete, and
+the Record arena counts its blocks as they are carved up, so the Records
+and the characters of their titles are told apart.
+The counts are the bytes asked of the heap, without the heap's own
+overhead, and cover every Library and Catalog in the process, including
+memory retired but not yet reclaimed. They are atomic, so any thread may
+allocate. If peak tracking is turned on, the most bytes ever in use are
+also kept, for each category and in total; this costs a few more atomic
+operations on each allocation, so it is off by default.
+*/
+
+#ifndef MEMORY_USAGE_H
+#define MEMORY_USAGE_H
+
+#include <cstddef>
+#include <memory>
+
+enum class Memory_category
+{
+    records,
+    strings,
+    freed_strings,
+    arena_free,
+    title_index,
+    id_index,
+    search_index,
+    versions,
+    members,
+    catalog,
+    num_categories
+};
+
+const int num_memory_categories = static_cast<int>(Memory_category::num_categories);
+
+// Return the name of the category for printing
+const char* memory_category_name(Memory_category category);
+
+// Count bytes allocated for, or freed from, the category
+void count_allocation(Memory_category category, std::size_t bytes);
+void count_deallocation(Memory_category category, std::size_t bytes);
+
+// Move bytes from one category to another, as when the arena hands out
+// part of a block
+void count_transfer(Memory_category from, Memory_category to, std::size_t bytes);
+
+// Return the bytes in use now, in the category or in total
+std::size_t memory_in_use(Memory_category category);
+std::size_t total_memory_in_use();
+
+// Keep the most bytes ever in use from now on. Must be called before any
+// other thread starts.
+void track_memory_peaks();
+
+// Return true if the peaks are being kept
+bool memory_peaks_tracked();
+
+// Return the most bytes that were in use since tracking started, in the
+// category or in total
+std::size_t memory_peak(Memory_category category);
+std::size_t total_memory_peak();
+
+// A standard allocator that counts what it allocates in the category
+template <typename T, Memory_category category>
+struct Counting_allocator
+{
+    using value_type = T;
+
+    // The category is not a type, so allocator_traits cannot rebind the
+    // allocator to the node types of a container by itself
+    template <typename U>
+    struct rebind
+    {
+        using other = Counting_allocator<U, category>;
+    };
+
+    Counting_allocator() = default;
+    template <typename U>
+    Counting_allocator(const Counting_allocator<U, category>&)
+    { }
+
+    T* allocate(std::size_t n)
+    {
+        T* ptr = std::allocator<T>().allocate(n);
+        count_allocation(category, n * sizeof(T));
+        return ptr;
+    }
+    void deallocate(T* ptr, std::size_t n)
+    {
+        count_deallocation(category, n * sizeof(T));
+        std::allocator<T>().deallocate(ptr, n);
+    }
+
+    template <typename U>
+    bool operator==(const Counting_allocator<U, category>&) const
+    {
+        return true;
+    }
+    template <typename U>
+    bool operator!=(const Counting_allocator<U, category>&) const
+    {
+        return false;
+    }
+};
+
+#endif
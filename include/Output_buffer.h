@@ -0,0 +1,78 @@
+/* An Output_buffer collects everything written to a stream, normally cout,
+and hands it to the stream's original buffer in large pieces, so printing
+or saving many lines costs one write instead of one per line.
+While it exists it is installed as the stream's buffer; when it is
+destroyed it flushes what is left and puts the original buffer back.
+When the pending output is written is set by the flush policy:
+    line - at every newline, as the program used to do with endl
+    command - at every command boundary, or when the buffer fills
+    full - only when the buffer fills, or when it is flushed explicitly
+*/
+
+#ifndef OUTPUT_BUFFER_H
+#define OUTPUT_BUFFER_H
+
+#include <cstddef>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+enum class Flush_policy
+{
+    line,
+    command,
+    full
+};
+
+class Output_buffer : public std::streambuf
+{
+public:
+    // Install the buffer under the stream
+    explicit Output_buffer(std::ostream& os_, Flush_policy policy_ = Flush_policy::command);
+
+    // Flush the pending output and give the stream back its own buffer
+    ~Output_buffer();
+
+    Output_buffer(const Output_buffer&) = delete;
+    Output_buffer& operator=(const Output_buffer&) = delete;
+
+    // Called at the end of each command; writes the pending output
+    // unless the policy is full.
+    void end_command();
+
+    Flush_policy get_flush_policy() const
+    {
+        return policy;
+    }
+    void set_flush_policy(Flush_policy policy_)
+    {
+        policy = policy_;
+    }
+
+protected:
+    // There is no put area; every write lands here and is appended
+    // to the pending output.
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char* s, std::streamsize n) override;
+    int sync() override;
+
+private:
+    // Write the pending output if the buffer is full or the policy
+    // asks for it at a newline.
+    void check_flush(bool newline);
+
+    // Write the pending output to the original buffer and flush it.
+    // Return false if it could not be written.
+    bool write_pending();
+
+    std::ostream& os;
+    std::streambuf* original;
+    std::vector<char> pending;
+    Flush_policy policy;
+};
+
+// Return the flush policy named by the string, or throw an Error if
+// there is no policy with that name.
+Flush_policy flush_policy_from_name(const char* name);
+
+#endif
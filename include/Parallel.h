@@ -0,0 +1,87 @@
+/* Helpers for running work on several threads at once.
+The work runs on one shared pool of threads, started when it is first
+needed. Each pool thread has its own queue of tasks: it takes tasks from
+the back of its own queue and, when that is empty, steals from the front
+of the others'. A thread that waits for tasks it handed out runs queued
+tasks itself meanwhile, so work may hand out more work and wait for it
+without tying up the pool.
+parallel_invoke runs a few different tasks side by side, and
+parallel_for splits a range of indexes into parts, several per thread,
+so that threads that finish early take over parts from the others.
+parallel_collect does the same and returns each part's result in the
+order of the parts, so that the combined result does not depend on which
+thread ran which part. All of them wait for all of the work to finish;
+if any of it throws, the first exception is rethrown on the calling
+thread afterwards.
+*/
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+// Run each task on the pool and wait for all of them.
+void parallel_invoke(const std::vector<std::function<void()>>& tasks);
+
+// Return the number of threads the hardware runs at once.
+std::size_t hardware_threads();
+
+// Set the number of threads parallel work runs on, counting the thread
+// that waits for it. Must be called before any parallel work is done;
+// by default it is the number of hardware threads.
+void set_parallel_threads(std::size_t num_threads);
+
+// Return the number of threads parallel work runs on.
+std::size_t parallel_threads();
+
+// Return the number of parts to split [0, n) into: a few per thread, but
+// fewer if that would make a part shorter than min_part, and at least one.
+inline std::size_t parallel_parts(std::size_t n, std::size_t min_part)
+{
+    const std::size_t parts_per_thread = 4;
+    std::size_t num_parts = parallel_threads() == 1 ? 1 : parallel_threads() * parts_per_thread;
+    num_parts = std::min(num_parts, n / std::max<std::size_t>(1, min_part));
+    return std::max<std::size_t>(1, num_parts);
+}
+
+// Call func(begin, end) on contiguous parts of [0, n), a few parts per
+// thread, on the pool. A range shorter than min_part per part is split
+// into fewer parts.
+template <typename F>
+void parallel_for(std::size_t n, std::size_t min_part, F func)
+{
+    std::size_t num_parts = parallel_parts(n, min_part);
+    if (num_parts == 1) {
+        func(std::size_t(0), n);
+        return;
+    }
+
+    std::vector<std::function<void()>> tasks;
+    for (std::size_t part = 0; part < num_parts; ++part) {
+        std::size_t begin = n * part / num_parts;
+        std::size_t end = n * (part + 1) / num_parts;
+        tasks.push_back([=, &func] { func(begin, end); });
+    }
+    parallel_invoke(tasks);
+}
+
+// Call func(begin, end) on contiguous parts of [0, n) as parallel_for
+// does, and return what it returns for each part, in the order of the
+// parts.
+template <typename F>
+auto parallel_collect(std::size_t n, std::size_t min_part, F func)
+    -> std::vector<decltype(func(std::size_t(0), std::size_t(0)))>
+{
+    std::size_t num_parts = parallel_parts(n, min_part);
+    std::vector<decltype(func(std::size_t(0), std::size_t(0)))> results(num_parts);
+    parallel_for(num_parts, 1, [&](std::size_t first_part, std::size_t last_part) {
+        for (std::size_t part = first_part; part < last_part; ++part)
+            results[part] = func(n * part / num_parts, n * (part + 1) / num_parts);
+    });
+    return results;
+}
+
+#endif
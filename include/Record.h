@@ -1,40 +1,43 @@
 // A Record ontains a unique ID number, a rating, and a title
 // and medium name as strings.
+// Records live in the Library's Record_arena, which also holds the
+// characters of their titles and a shared table of interned media
+// names, so a Record has no heap data of its own.
 
 #ifndef RECORD_H
 #define RECORD_H
 
+#include <fstream>
 #include <string>
+#include <string_view>
+
+class Input_reader;
 
 class Record
 {
 public:
     // Create a Record object initialized with the supplied values.
-    // The rating is set to 0.
-    Record(int ID_, const std::string& medium_, const std::string& title_)
+    // The rating is set to 0. The strings must outlive the Record.
+    Record(int ID_, const std::string& medium_, std::string_view title_)
     {
         id = ID_;
-        medium = medium_;
+        medium = &medium_;
         title = title_;
         rating = 0;
+        num_collections = 0;
     }
 
     // Create a record object with the given ID, medium, string and rating.
-    Record(int ID_, const std::string& medium_, const std::string& title_, int rating_)
+    // The strings must outlive the Record.
+    Record(int ID_, const std::string& medium_, std::string_view title_, int rating_)
     {
         id = ID_;
-        medium = medium_;
+        medium = &medium_;
         title = title_;
         rating = rating_;
+        num_collections = 0;
     }
 
-    // Construct a Record object from a file stream in save format.
-    // Throw Error exception if invalid data discovered in file.
-    // No check made for whether the Record already exists or not.
-    // Input string data is read directly into the member variables.
-    // The record number will be set from the saved data.
-    Record(std::ifstream& is);
-
     // These declarations help ensure that Record objects are unique
     Record(const Record&) = delete;  // disallow copy construction
     Record(Record&&) = delete;  // disallow move construction
@@ -42,15 +45,16 @@ public:
     Record& operator=(Record&&) = delete;  // disallow move assignment
 
     // Accessors
-    const std::string get_medium() const
+    // Records with the same medium share one interned string
+    const std::string& get_medium() const
     {
-        return medium;
+        return *medium;
     }
     int get_ID() const
     {
         return id;
     }
-    const std::string& get_title() const
+    std::string_view get_title() const
     {
         return title;
     }
@@ -58,13 +62,13 @@ public:
     {
         return rating;
     }
+    // Number of Collections the Record is a member of
+    int get_num_collections() const
+    {
+        return num_collections;
+    }
 
-    // Read in a new rating and set the rating to the new value
-    // If an integer is not read, or if the rating is not
-    // between 1 and 5 inclusive, an exception is thrown
-    void read_and_set_rating();
-
-    // Write a Record's data to a stream in save format with final endl.
+    // Write a Record's data to a stream in save format with a final newline.
     // The record ID number is saved.
     void save(std::ostream& os) const;
 
@@ -72,18 +76,28 @@ public:
     friend std::ostream& operator<<(std::ostream& os, const Record& record);
     friend std::ostream& operator<<(std::ostream& os, const Record* record);
 
+    // The Library changes a Record's title and rating and keeps
+    // its membership count
+    friend class Library;
+
 private:
-    int id, rating;
-    std::string medium, title;
+    int id, rating, num_collections;
+    const std::string* medium;
+    std::string_view title;
 };
 
-// Print a Record's data to the stream without a final endl.
+// Read in a new rating and return it. If an integer is not read,
+// or if the rating is not between 1 and 5 inclusive, an exception
+// is thrown
+int read_rating(Input_reader& input);
+
+// Print a Record's data to the stream, ending with a newline.
 // Output order is ID number followed by a ':' then medium, rating,
 // title, separated by one space. If the rating is zero, a 'u' is
 // printed instead of the rating.
 std::ostream& operator<<(std::ostream& os, const Record& record);
 
-// Print a Record pointer's data to the stream without a final endl.
+// Print a Record pointer's data to the stream, ending with a newline.
 // Output order is ID number followed by a ':' then medium, rating,
 // title, separated by one space. If the rating is zero, a 'u' is
 // printed instead of the rating.
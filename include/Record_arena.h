@@ -0,0 +1,183 @@
+/* A Record_arena allocates Records, and the characters of their titles,
+out of large blocks of memory owned by the Library.
+Media names repeat across many Records, so the arena interns them: each
+distinct medium is stored once and every Record points to the shared copy.
+Records are carved out of the blocks one after another. The memory of a
+deleted Record goes onto a free list and is reused for the next Record.
+The characters of a replaced or deleted title may still be shown by a
+published library version, so they are set aside, handed over to the
+epoch when the next version is published, and come back for reuse once
+no reader can see them. To reuse them without splitting them up, each
+string is stored in a slot of one of a fixed set of sizes: multiples of
+8 bytes up to 256, and above that four sizes to each power of two. A
+freed slot is only reused for a string with the same slot size, so
+repeated changes never leave fragments behind.
+Releasing the arena frees every block at once; no Record is destroyed
+individually, which is possible because Records own no heap data.
+The bytes of each block are counted in the memory usage as free space
+until they are handed out to a Record or a string.
+*/
+
+#ifndef RECORD_ARENA_H
+#define RECORD_ARENA_H
+
+#include "Memory_usage.h"
+#include "Record.h"
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class Record_arena
+{
+public:
+    Record_arena()
+        : block_pos(nullptr)
+        , block_left(0)
+        , free_records(nullptr)
+        , bytes_reserved(0)
+        , record_bytes(0)
+        , string_bytes(0)
+        , freed_bytes(0)
+        , unretired_bytes(0)
+    { }
+
+    ~Record_arena();
+
+    // A moved-from arena is left empty
+    Record_arena(Record_arena&& other);
+    Record_arena& operator=(Record_arena&& other);
+    Record_arena(const Record_arena&) = delete;
+    Record_arena& operator=(const Record_arena&) = delete;
+
+    // Create a Record in the arena, with a copy of the title also stored
+    // in the arena and the medium interned.
+    Record* create(int id, std::string_view medium, std::string_view title, int rating);
+
+    // Return the shared copy of the medium, adding it if it is new.
+    const std::string& intern_medium(std::string_view medium);
+
+    // Copy the string into the arena and return a view of the copy,
+    // reusing the slot of a freed string of the same slot size.
+    std::string_view store_string(std::string_view str);
+
+    // Set the slot of a string stored in the arena aside for reuse.
+    // Published versions may still show the string, so its bytes are
+    // only reused after retire_freed_strings and once no reader can see
+    // them. The string must not be used afterwards.
+    void free_string(std::string_view str);
+
+    // Hand the strings freed since the last call over to the epoch, to
+    // be reused once no reader can see them. Call when a version that no
+    // longer shows them has been published.
+    void retire_freed_strings();
+
+    // Put the Record's memory on the free list for reuse. The Record
+    // must not be used afterwards.
+    void destroy(Record* record_ptr);
+
+    // Free all of the arena's memory in one step. Every Record created
+    // in the arena becomes invalid.
+    void release();
+
+    void swap(Record_arena& other);
+
+    // Accessors
+    // Bytes held in blocks, and bytes handed out to live Records and strings
+    std::size_t get_bytes_reserved() const
+    {
+        return bytes_reserved;
+    }
+    std::size_t get_bytes_used() const
+    {
+        return record_bytes + string_bytes;
+    }
+    // Bytes in the slots of freed strings not yet reused, and those of
+    // them freed since the last retire_freed_strings
+    std::size_t get_bytes_freed() const
+    {
+        return freed_bytes;
+    }
+    std::size_t get_bytes_unretired() const
+    {
+        return unretired_bytes;
+    }
+
+private:
+    // Return size bytes aligned to align for the category of memory,
+    // taking a new block if the current one does not have room.
+    char* allocate(std::size_t size, std::size_t align, Memory_category category);
+
+    // The slot of a freed string, and the class of its size
+    struct Slot
+    {
+        char* data;
+        int slot_class;
+    };
+    using Slots_t = std::vector<Slot, Counting_allocator<Slot, Memory_category::strings>>;
+
+    // Freed slots ready for reuse, by class. The batches handed to the
+    // epoch refer to it weakly, so the slots of a batch that comes back
+    // after the arena was released are dropped.
+    class Free_strings
+    {
+    public:
+        void add(const Slot& slot);
+
+        // Return a freed slot of the class, or nullptr if there is none.
+        char* take(int slot_class);
+
+    private:
+        using Class_t = std::vector<char*, Counting_allocator<char*, Memory_category::strings>>;
+        std::vector<Class_t, Counting_allocator<Class_t, Memory_category::strings>> classes;
+    };
+
+    // Strings freed in one period between publications
+    struct Freed_batch
+    {
+        std::weak_ptr<Free_strings> target;
+        Slots_t slots;
+    };
+
+    // Give a retired batch's strings back to its arena, if it still has them
+    static void return_freed(void* batch_ptr);
+
+    // Deleted Records are chained through their own memory
+    struct Free_record
+    {
+        Free_record* next;
+    };
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char* block_pos;
+    std::size_t block_left;
+    Free_record* free_records;
+
+    // Interned media; the deque never moves its strings
+    using Media_t = std::deque<std::string, Counting_allocator<std::string, Memory_category::strings>>;
+    using Medium_index_t = std::unordered_map<std::string_view, const std::string*, std::hash<std::string_view>,
+        std::equal_to<std::string_view>,
+        Counting_allocator<std::pair<const std::string_view, const std::string*>, Memory_category::strings>>;
+    Media_t media;
+    Medium_index_t medium_index;
+
+    // Freed strings, made when first needed, and those freed since the
+    // last retire_freed_strings
+    std::shared_ptr<Free_strings> free_strings;
+    Slots_t unretired_strings;
+
+    // Bytes held in blocks, and bytes of them handed out to live Records
+    // and to the slots of strings, and held by freed slots. The rest of the blocks is
+    // counted as free space.
+    std::size_t bytes_reserved;
+    std::size_t record_bytes;
+    std::size_t string_bytes;
+    std::size_t freed_bytes;
+    std::size_t unretired_bytes;
+};
+
+#endif
@@ -0,0 +1,95 @@
+/* A Record_id_index maps Record ID numbers to Record pointers.
+Record IDs are handed out densely from the record_id counter, so the
+index is mostly a table of slots addressed directly by ID, with the few
+IDs far beyond the rest kept aside in order; see Id_table.h. A deleted
+Record leaves a tombstone (a null slot) behind, so lookups, insertions
+and deletions of dense IDs are all constant time. Iteration visits the
+live Records in ascending ID order.
+The index does not own the Records it points to.
+*/
+
+#ifndef RECORD_ID_INDEX_H
+#define RECORD_ID_INDEX_H
+
+#include "Id_table.h"
+#include "Memory_usage.h"
+#include "Record.h"
+
+class Record_id_index
+{
+    // The table counts its memory as the ID index's
+    using Table_t = Id_table<Record*, Memory_category::id_index>;
+
+public:
+    // Forward iterator over the live Records, skipping tombstones
+    using const_iterator = Table_t::const_iterator;
+
+    Record_id_index() = default;
+
+    // A moved-from index is left empty
+    Record_id_index(Record_id_index&& other) = default;
+    Record_id_index& operator=(Record_id_index&& other) = default;
+
+    // Put the Record into the slot for its ID. Return false, and leave the
+    // index unchanged, if the ID is not positive or the slot is taken.
+    bool insert(Record* record_ptr)
+    {
+        return table.insert(record_ptr->get_ID(), record_ptr);
+    }
+
+    // Return the Record with the given ID, or nullptr if there is none.
+    Record* find(int id) const
+    {
+        Record* const* slot = table.find(id);
+        return slot == nullptr ? nullptr : *slot;
+    }
+
+    // Leave a tombstone in the slot for the given ID.
+    void erase(int id)
+    {
+        table.erase(id);
+    }
+
+    // Forget every Record; the Records themselves are not deleted.
+    void clear()
+    {
+        table.clear();
+    }
+
+    // Exchange contents with another index
+    void swap(Record_id_index& other)
+    {
+        table.swap(other.table);
+    }
+
+    // Accessors
+    bool empty() const
+    {
+        return table.empty();
+    }
+    int size() const
+    {
+        return table.size();
+    }
+    const_iterator begin() const
+    {
+        return table.begin();
+    }
+    const_iterator end() const
+    {
+        return table.end();
+    }
+    const_iterator cbegin() const
+    {
+        return begin();
+    }
+    const_iterator cend() const
+    {
+        return end();
+    }
+
+private:
+    Table_t table;
+};
+
+#endif
@@ -0,0 +1,64 @@
+/* Snapshot formats for the sA and rA commands.
+The text format lists the number of Records, then one Record per line as
+ID, medium, rating and title; then the number of Collections, each as a
+line with its name and number of members followed by one member title per
+line. Restoring a text file maps it into memory, parses the Record lines
+on all hardware threads, and builds the Library's indexes in parallel.
+A file whose name ends in ".bin" holds the Library and Catalog in a
+versioned binary layout instead of the whitespace-delimited text format:
+
+    magic "SMMSNAP\0", u32 version
+    u32 number of media, then each medium as a length-prefixed string
+    u32 number of records, then for each record:
+        i32 ID, u32 medium index, i32 rating, length-prefixed title
+    u32 number of collections, in name order, then for each collection:
+        length-prefixed name, u32 number of members, i32 member IDs
+    u64 FNV-1a checksum of everything before it
+
+Integers are stored little-endian and strings are prefixed by a u32 length.
+Restoring maps the whole file into memory and builds the Records and
+Collections straight from the mapped bytes.
+*/
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "Catalog.h"
+#include "Library.h"
+#include <cstdint>
+#include <string>
+
+// Write the Library and Catalog to the named file, in the binary format
+// if the name selects it and in the text format otherwise. The data goes
+// to a temporary file that is synced and then renamed over the named
+// file, so the file is never left half written. Throw an Error if the
+// file cannot be opened or written; the named file is then untouched.
+void save_snapshot(const std::string& file_name, const Library& lib, const Catalog& cat);
+
+// Return true if the file name selects the binary snapshot format.
+bool is_binary_snapshot(const std::string& file_name);
+
+// Write the Library and then the Catalog to the named file in text
+// format. Throw an Error if the file cannot be opened for output.
+void save_text_snapshot(const std::string& file_name, const Library& lib, const Catalog& cat);
+
+// Restore the Library and Catalog from the named text file into the
+// given empty Library and Catalog. Throw an Error if the file cannot be
+// opened, ends early, has a negative or invalid number, a Record whose
+// ID or title is taken twice, or a member title that is not in the
+// Library; the given Library and Catalog are then left partly filled.
+void restore_text_snapshot(const std::string& file_name, Library& lib, Catalog& cat);
+
+// Write the Library and Catalog to the named file in binary snapshot
+// format and return its checksum. Throw an Error if the file cannot be
+// opened for output.
+uint64_t save_binary_snapshot(const std::string& file_name, const Library& lib, const Catalog& cat);
+
+// Restore the Library and Catalog from the named binary snapshot into
+// the given empty Library and Catalog. Throw an Error if the file cannot
+// be opened, or if it is truncated, has the wrong version or fails its
+// checksum; the given Library and Catalog are then left partly filled.
+// Return the snapshot's checksum, which identifies it.
+uint64_t restore_binary_snapshot(const std::string& file_name, Library& lib, Catalog& cat);
+
+#endif
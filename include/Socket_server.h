@@ -0,0 +1,80 @@
+/* A Socket_server listens on a Unix domain socket and runs a session for
+each client that connects, on a thread of its own, so many clients can
+be served at once. What a session does with its connection is up to the
+caller; the server only accepts, starts and collects the sessions.
+The server runs until the process is sent SIGINT or SIGTERM. It then
+stops accepting, shuts down the reading side of every connection, so
+that each session sees the end of its input at its next read, and waits
+for the sessions to end.
+A Socket_writer is a stream buffer that writes straight to a socket. A
+client that has gone away makes the writes fail rather than raising
+SIGPIPE.
+*/
+
+#ifndef SOCKET_SERVER_H
+#define SOCKET_SERVER_H
+
+#include <functional>
+#include <list>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+
+class Socket_server
+{
+public:
+    using Session = std::function<void(int client_fd)>;
+
+    // Listen on the socket with the given path, replacing a socket left
+    // there by an earlier server. Throw an Error if it cannot be made.
+    explicit Socket_server(const std::string& path_);
+
+    // Stop listening and remove the socket
+    ~Socket_server();
+
+    Socket_server(const Socket_server&) = delete;
+    Socket_server& operator=(const Socket_server&) = delete;
+
+    // Run the session for each client until SIGINT or SIGTERM arrives,
+    // then wait for the sessions to end.
+    void run(const Session& session);
+
+private:
+    struct Client
+    {
+        int fd;
+        std::thread worker;
+        bool is_done;
+    };
+
+    // Accept clients and start their sessions until the listening
+    // socket is shut down
+    void accept_clients(const Session& session);
+
+    // Wait for the sessions that have ended and close their connections
+    void collect_done_clients();
+
+    std::string path;
+    int listen_fd;
+    std::mutex clients_mutex;
+    std::list<Client> clients;
+};
+
+class Socket_writer : public std::streambuf
+{
+public:
+    explicit Socket_writer(int fd_)
+        : fd(fd_)
+    { }
+
+protected:
+    // There is no put area; every write goes to the socket
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char* s, std::streamsize n) override;
+
+private:
+    int fd;
+};
+
+#endif
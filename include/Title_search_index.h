@@ -0,0 +1,106 @@
+/* A Title_search_index answers case-insensitive substring queries over
+the titles in the Library.
+Every title is kept lower-cased in one contiguous buffer, and each
+three-character sequence (trigram) of a lower-cased title has a posting
+list of the IDs of the Records whose titles contain it. A query of three
+or more characters only looks at the Records on the shortest of its
+trigrams' posting lists that are also on all the others; a shorter query
+scans the whole contiguous buffer with the case-insensitive search
+kernel, which needs no allocation per Record. Either way the titles are
+checked in parts on the threads of the parallel pool.
+The index does not own the Records it points to.
+*/
+
+#ifndef TITLE_SEARCH_INDEX_H
+#define TITLE_SEARCH_INDEX_H
+
+#include "Id_table.h"
+#include "Memory_usage.h"
+#include "Record.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class Title_search_index
+{
+public:
+    Title_search_index()
+        : dead_bytes(0)
+    { }
+
+    // Index the Record under its current title.
+    void insert(Record* record_ptr);
+
+    // Stop indexing the Record; call before its title changes.
+    void erase(Record* record_ptr);
+
+    // Return the Records whose lower-cased titles contain the lower-cased
+    // string, in alphabetical order of title.
+    std::vector<Record*> find(std::string_view lowered) const;
+
+    void clear();
+
+    void swap(Title_search_index& other);
+
+private:
+    // The index's containers count their memory as the search index's
+    template <typename T>
+    using Counted_vector = std::vector<T, Counting_allocator<T, Memory_category::search_index>>;
+    using Buffer_t =
+        std::basic_string<char, std::char_traits<char>, Counting_allocator<char, Memory_category::search_index>>;
+    using Postings_t = std::unordered_map<std::uint32_t, Counted_vector<int>, std::hash<std::uint32_t>,
+        std::equal_to<std::uint32_t>,
+        Counting_allocator<std::pair<const std::uint32_t, Counted_vector<int>>, Memory_category::search_index>>;
+
+    // Where a Record's lower-cased title lives in the buffer
+    struct Entry
+    {
+        Record* record_ptr;
+        std::size_t offset;
+        std::size_t size;
+
+        // A value-initialized Entry marks an ID that is not indexed
+        bool operator==(const Entry& other) const
+        {
+            return record_ptr == other.record_ptr && offset == other.offset && size == other.size;
+        }
+    };
+
+    std::string_view folded_title(const Entry& entry) const
+    {
+        return std::string_view(folded.data() + entry.offset, entry.size);
+    }
+
+    // Return the Records whose titles, among those listed in buffer_order
+    // from first up to last, contain the lower-cased string, in buffer order
+    std::vector<Record*> scan_titles(std::size_t first, std::size_t last, std::string_view lowered) const;
+
+    // Call func with each distinct trigram of the lower-cased string
+    template <typename F>
+    static void for_each_trigram(std::string_view lowered, F func);
+
+    // Rebuild the buffer without the titles of erased Records
+    void compact();
+
+    // Lower-cased titles, one after another, each followed by a '\0'
+    // so that no match runs from one title into the next
+    Buffer_t folded;
+    std::size_t dead_bytes;
+
+    // The offset and ID of each title in the buffer, in buffer order.
+    // Titles of erased Records stay listed until the buffer is compacted.
+    Counted_vector<std::pair<std::size_t, int>> buffer_order;
+
+    // The Entry of each indexed Record, by its ID
+    Id_table<Entry, Memory_category::search_index> entries;
+
+    // Sorted Record IDs for each trigram
+    Postings_t postings;
+};
+
+#endif
@@ -1,25 +1,42 @@
 #ifndef UTILITY_H
 #define UTILITY_H
 
+#include "Memory_usage.h"
 #include "Record.h"
+#include <cstdint>
 #include <utility>
 #include <set>
 #include <string>
+#include <string_view>
+
+class Input_reader;
 
 // Utility functions, constants, and classes used by
 // more than one other modules
 
 // Functor used for ordering records in an alphabetical order.
+// It is transparent so that a set of Record pointers can be
+// searched directly with a title string.
 struct Title_compare
 {
+    using is_transparent = void;
+
     bool operator()(const Record* r1, const Record* r2) const
     {
         return r1->get_title() < r2->get_title();
     }
+    bool operator()(const Record* r1, std::string_view title) const
+    {
+        return r1->get_title() < title;
+    }
+    bool operator()(std::string_view title, const Record* r2) const
+    {
+        return title < r2->get_title();
+    }
 };
 
-using Lib_ti_t = std::set<Record*, Title_compare>;
-using Lib_ti_iter = std::set<Record*, Title_compare>::iterator;
+using Lib_ti_t = std::set<Record*, Title_compare, Counting_allocator<Record*, Memory_category::title_index>>;
+using Lib_ti_iter = Lib_ti_t::iterator;
 
 // a simple class for error exceptions - msg points to a
 // C-string error message
@@ -31,29 +48,32 @@ struct Error
     const char* const msg;
 };
 
-// Functor for heterogeneous lookups for Record pointers.
-struct Title_hetero_compare
-{
-    bool operator()(const Record* r1, const std::string& title) const
-    {
-        return r1->get_title() < title;
-    }
-};
-
 // Perform lower_bound on the library to look for a Record
 // Return a pair whose first member is an iterator to a member
-// of the vector while second member is a bool indicating whether the
+// of the set while second member is a bool indicating whether the
 // Record was found or not.
-std::pair<Lib_ti_iter, bool> lib_binary_search(const Lib_ti_t& lib_ti, const std::string& title);
+std::pair<Lib_ti_iter, bool> lib_binary_search(const Lib_ti_t& lib_ti, std::string_view title);
+
+// Return the first eight bytes of the title as a big-endian number,
+// padded with zero bytes, so that comparing two prefixes orders the
+// titles the same way comparing the titles does, unless they are equal.
+std::uint64_t title_prefix(std::string_view title);
+
+// Return the text without its leading and trailing whitespace, and with
+// each run of whitespace inside it cut down to its first character.
+// This is how titles are cleaned up wherever they are read.
+std::string remove_unneeded_white(std::string_view text);
+
+// Return true if remove_unneeded_white would leave the text unchanged.
+bool is_free_of_unneeded_white(std::string_view text);
 
 // Read an integer and throw an Error if it is not an integer.
-int read_and_check_integer();
+int read_and_check_integer(Input_reader& input);
 
-// Check if stream is good and throw an Error if it is not.
-void check_stream_state(std::ifstream& is);
+// Flush the named file or directory to the disk. Return false on failure.
+bool sync_to_disk(const std::string& path);
 
-// Check if stream is good and value is not negative. Throw an Error
-// if the stream is not good or if the value is negative.
-void check_stream_state_and_value(std::ifstream& is, int value);
+// Return the directory that holds the named file
+std::string directory_of(const std::string& file_name);
 
 #endif
\ No newline at end of file
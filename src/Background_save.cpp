@@ -0,0 +1,98 @@
+#include "Background_save.h"
+#include "Snapshot.h"
+#include "Utility.h"
+#include <cstring>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Wait for a save that is still running
+Background_save::~Background_save()
+{
+    if (!is_running())
+        return;
+    int status;
+    waitpid(child, &status, 0);
+    close(message_fd);
+}
+
+// Start saving the Library and Catalog to the named file. Throw an
+// Error if a save is already running or the child cannot be started.
+void Background_save::start(const string& file_name_, const Library& lib, const Catalog& cat)
+{
+    if (is_running())
+        throw Error("A save is already running!");
+
+    int fds[2];
+    if (pipe(fds) != 0)
+        throw Error("Could not start saving!");
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        throw Error("Could not start saving!");
+    }
+
+    if (pid == 0) {
+        // The child only writes the file. It leaves the parent's pending
+        // output and journal alone by exiting without running destructors.
+        close(fds[0]);
+        const char* error_msg = nullptr;
+        try {
+            save_snapshot(file_name_, lib, cat);
+        } catch (Error& e) {
+            error_msg = e.msg;
+        } catch (...) {
+            error_msg = "Could not write file!";
+        }
+        if (error_msg != nullptr && write(fds[1], error_msg, strlen(error_msg)) < 0)
+            _exit(2);
+        _exit(error_msg != nullptr ? 1 : 0);
+    }
+
+    close(fds[1]);
+    file_name = file_name_;
+    child = pid;
+    message_fd = fds[0];
+}
+
+// Return a line reporting how far the running save has got, or how it
+// ended if it has just finished; return an empty string if no save has
+// been started since the last report of one ending.
+string Background_save::check()
+{
+    if (!is_running())
+        return string();
+
+    int status;
+    pid_t result = waitpid(child, &status, WNOHANG);
+    if (result == 0) {
+        // The file is written under its temporary name until it is done
+        struct stat file_stat;
+        long long bytes_written = 0;
+        if (stat((file_name + ".tmp").c_str(), &file_stat) == 0)
+            bytes_written = file_stat.st_size;
+        return "Saving " + file_name + " in the background: " + to_string(bytes_written) + " bytes written";
+    }
+
+    return finish(result == child ? status : -1);
+}
+
+// Collect the finished child and return the report on how it ended
+string Background_save::finish(int status)
+{
+    char error_msg[256];
+    ssize_t size = read(message_fd, error_msg, sizeof(error_msg));
+    close(message_fd);
+    message_fd = -1;
+    child = -1;
+
+    if (status != -1 && WIFEXITED(status) && WEXITSTATUS(status) == 0)
+        return "Data saved to " + file_name;
+    if (size > 0)
+        return string(error_msg, size);
+    return "Could not write file!";
+}
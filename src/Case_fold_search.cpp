@@ -0,0 +1,197 @@
+#include "Case_fold_search.h"
+#include <cstdint>
+#if defined(__x86_64__)
+#    include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+using Search_fn = size_t (*)(const char* haystack, size_t size, const char* needle, size_t needle_size);
+
+char fold(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
+// Compare size bytes of text, folded, with the lower-case needle
+bool equal_folded(const char* text, const char* needle, size_t size)
+{
+    for (size_t i = 0; i < size; ++i) {
+        if (fold(text[i]) != needle[i])
+            return false;
+    }
+    return true;
+}
+
+// Check the candidate positions from position start on, one at a time
+size_t search_scalar_from(const char* haystack, size_t size, const char* needle, size_t needle_size, size_t start)
+{
+    for (size_t i = start; i + needle_size <= size; ++i) {
+        if (fold(haystack[i]) == needle[0] && equal_folded(haystack + i + 1, needle + 1, needle_size - 1))
+            return i;
+    }
+    return string_view::npos;
+}
+
+#if defined(__x86_64__)
+
+// Each block compares the needle's first and last characters with the
+// folded text at every position at once; only positions where both
+// match are checked in full.
+
+__m128i fold_sse2(__m128i chars)
+{
+    __m128i above = _mm_cmpgt_epi8(chars, _mm_set1_epi8('A' - 1));
+    __m128i below = _mm_cmplt_epi8(chars, _mm_set1_epi8('Z' + 1));
+    return _mm_or_si128(chars, _mm_and_si128(_mm_and_si128(above, below), _mm_set1_epi8(0x20)));
+}
+
+size_t search_sse2(const char* haystack, size_t size, const char* needle, size_t needle_size)
+{
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[needle_size - 1]);
+
+    size_t i = 0;
+    for (; i + needle_size - 1 + 16 <= size; i += 16) {
+        __m128i block_first = fold_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(haystack + i)));
+        __m128i block_last
+            = fold_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(haystack + i + needle_size - 1)));
+
+        uint32_t mask = _mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(block_first, first), _mm_cmpeq_epi8(block_last, last)));
+        while (mask != 0) {
+            size_t pos = i + __builtin_ctz(mask);
+            if (equal_folded(haystack + pos + 1, needle + 1, needle_size - 1))
+                return pos;
+            mask &= mask - 1;
+        }
+    }
+    return search_scalar_from(haystack, size, needle, needle_size, i);
+}
+
+__attribute__((target("avx2"))) __m256i fold_avx2(__m256i chars)
+{
+    __m256i above = _mm256_cmpgt_epi8(chars, _mm256_set1_epi8('A' - 1));
+    __m256i below = _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), chars);
+    return _mm256_or_si256(chars, _mm256_and_si256(_mm256_and_si256(above, below), _mm256_set1_epi8(0x20)));
+}
+
+__attribute__((target("avx2"))) size_t search_avx2(
+    const char* haystack, size_t size, const char* needle, size_t needle_size)
+{
+    // Text shorter than one block, such as most single titles, goes
+    // straight to the sse2 kernel, before any 256-bit register is used
+    if (needle_size - 1 + 32 > size)
+        return search_sse2(haystack, size, needle, needle_size);
+
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[needle_size - 1]);
+
+    size_t i = 0;
+    for (; i + needle_size - 1 + 32 <= size; i += 32) {
+        __m256i block_first = fold_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(haystack + i)));
+        __m256i block_last
+            = fold_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(haystack + i + needle_size - 1)));
+
+        uint32_t mask = _mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(block_first, first), _mm256_cmpeq_epi8(block_last, last)));
+        while (mask != 0) {
+            size_t pos = i + __builtin_ctz(mask);
+            if (equal_folded(haystack + pos + 1, needle + 1, needle_size - 1))
+                return pos;
+            mask &= mask - 1;
+        }
+    }
+    // The sse2 kernel finishes the last partial block. Clearing the upper
+    // halves of the registers first spares its SSE instructions the
+    // penalty for mixing them with dirty AVX state.
+    _mm256_zeroupper();
+    size_t pos = search_sse2(haystack + i, size - i, needle, needle_size);
+    return pos == string_view::npos ? pos : i + pos;
+}
+
+#endif
+
+size_t search_scalar(const char* haystack, size_t size, const char* needle, size_t needle_size)
+{
+    return search_scalar_from(haystack, size, needle, needle_size, 0);
+}
+
+// Return true if the processor can run the kernel
+bool supported(Case_fold_kernel kernel)
+{
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    return kernel != Case_fold_kernel::avx2 || __builtin_cpu_supports("avx2");
+#else
+    return kernel == Case_fold_kernel::scalar;
+#endif
+}
+
+// Return the search function of the kernel
+Search_fn kernel_function(Case_fold_kernel kernel)
+{
+    switch (kernel) {
+#if defined(__x86_64__)
+    case Case_fold_kernel::avx2:
+        return search_avx2;
+    case Case_fold_kernel::sse2:
+        return search_sse2;
+#endif
+    default:
+        return search_scalar;
+    }
+}
+
+// Pick the widest kernel the processor supports
+Case_fold_kernel choose_kernel()
+{
+    if (supported(Case_fold_kernel::avx2))
+        return Case_fold_kernel::avx2;
+    if (supported(Case_fold_kernel::sse2))
+        return Case_fold_kernel::sse2;
+    return Case_fold_kernel::scalar;
+}
+
+const Case_fold_kernel chosen_kernel = choose_kernel();
+const Search_fn kernel = kernel_function(chosen_kernel);
+
+// Search with the function, handling the needles no kernel needs to see
+size_t search_with(Search_fn search, string_view haystack, string_view lowered_needle)
+{
+    if (lowered_needle.empty())
+        return 0;
+    if (lowered_needle.size() > haystack.size())
+        return string_view::npos;
+    return search(haystack.data(), haystack.size(), lowered_needle.data(), lowered_needle.size());
+}
+
+}  // namespace
+
+// Return the position of the first occurrence of the needle in the
+// haystack, or std::string_view::npos if there is none.
+size_t find_case_insensitive(string_view haystack, string_view lowered_needle)
+{
+    return search_with(kernel, haystack, lowered_needle);
+}
+
+// Return the kernel find_case_insensitive runs on
+Case_fold_kernel chosen_case_fold_kernel()
+{
+    return chosen_kernel;
+}
+
+// Return true if the processor can run the kernel
+bool case_fold_kernel_supported(Case_fold_kernel kernel)
+{
+    return supported(kernel);
+}
+
+// Search as find_case_insensitive does, on the given kernel, which must
+// be supported.
+size_t find_case_insensitive_with(Case_fold_kernel kernel, string_view haystack, string_view lowered_needle)
+{
+    return search_with(kernel_function(kernel), haystack, lowered_needle);
+}
@@ -0,0 +1,65 @@
+#include "Catalog.h"
+#include <utility>
+
+using namespace std;
+
+// A moved-from Catalog is left empty
+Catalog::Catalog(Catalog&& other)
+{
+    swap(other);
+}
+
+// Return the Collection with the given name, or nullptr if there is none.
+Collection* Catalog::find(string_view name)
+{
+    auto iter = collections.find(name);
+    return iter != collections.end() ? &iter->second : nullptr;
+}
+
+const Collection* Catalog::find(string_view name) const
+{
+    auto iter = collections.find(name);
+    return iter != collections.end() ? &iter->second : nullptr;
+}
+
+// Add an empty Collection with the given name.
+// Return nullptr if the name is taken.
+Collection* Catalog::add(const string& name)
+{
+    auto iter_bool = collections.try_emplace(name, name);
+    return iter_bool.second ? &iter_bool.first->second : nullptr;
+}
+
+// Add the given Collection, whose memberships are counted in the Library.
+// If the name is taken, release its memberships and return nullptr.
+Collection* Catalog::add(Collection&& collection, Library& lib)
+{
+    auto iter = collections.lower_bound(collection.get_name());
+    if (iter != collections.end() && iter->first == collection.get_name()) {
+        collection.clear(lib);
+        return nullptr;
+    }
+
+    iter = collections.emplace_hint(iter, collection.get_name(), move(collection));
+    return &iter->second;
+}
+
+// Release the Collection's memberships and remove it from the Catalog.
+void Catalog::remove(Collection& collection, Library& lib)
+{
+    collection.clear(lib);
+    collections.erase(collections.find(collection.get_name()));
+}
+
+// Release all memberships and remove every Collection.
+void Catalog::clear(Library& lib)
+{
+    for (auto& name_collection : collections)
+        name_collection.second.clear(lib);
+    collections.clear();
+}
+
+void Catalog::swap(Catalog& other)
+{
+    collections.swap(other.collections);
+}
@@ -3,128 +3,168 @@
 #include <algorithm>
 #include <fstream>
 #include <iostream>
-#include <iterator>
 #include <utility>
+#include <vector>
 
 using namespace std;
 
-/* Construct a Collection from an input file stream in save format,
-using the record list, restoring all the Record information.
-Record list is needed to resolve references to record members.
-No check made for whether the Collection already exists or not.
-Throw Error exception if invalid data discovered in file.
-String data input is read directly into the member variable. */
-Collection::Collection(ifstream& is, const Lib_ti_t& lib_ti)
-{
-    string name_;
-    is >> name_;
-
-    check_stream_state(is);
-
-    name = move(name_);
-
-    int num_member;
-    is >> num_member;
+namespace {
 
-    check_stream_state_and_value(is, num_member);
+// A Collection holding at least this fraction of the Library is
+// printed in the Library's own title order
+const int library_walk_fraction = 8;
 
-    if (num_member != 0) {
-        // removing a whitespace
-        is.get();
+}  // namespace
 
-        // Read in members
-        for (int i = 0; i < num_member; ++i) {
-            check_stream_state(is);
+// Construct a Collection with the given name whose members are the
+// Records with the given IDs, which must be in the Library. A repeated
+// ID is counted once.
+Collection::Collection(string name_, const vector<int>& member_ids, Library& lib)
+    : name(move(name_))
+{
+    for (int id : member_ids) {
+        if (member_list.insert(id))
+            lib.add_membership(lib.find_id(id));
+    }
+}
 
-            string title;
-            getline(is, title);
+// Construct a Collection with the given name and the same members
+// as the original.
+Collection::Collection(const Collection& original, string name_, Library& lib)
+    : member_list(original.member_list)
+    , name(move(name_))
+{
+    member_list.for_each([&](uint32_t id) { lib.add_membership(lib.find_id(id)); });
+}
 
-            check_stream_state(is);
+// Construct a Collection by combining Collections c1 and c2 and the
+// given name.
+Collection::Collection(const Collection& c1, const Collection& c2, string name_, Library& lib)
+    : Collection(Member_set::set_union(c1.member_list, c2.member_list), move(name_), lib)
+{ }
 
-            // .first contains the iterator and .second contains a boolean
-            // indicating whether the item was found or not.
-            pair<Lib_ti_iter, bool> iter_bool = lib_binary_search(lib_ti, title);
+// Return a Collection with the given name whose members are those in
+// both c1 and c2.
+Collection Collection::intersect(const Collection& c1, const Collection& c2, string name_, Library& lib)
+{
+    return Collection(Member_set::set_intersection(c1.member_list, c2.member_list), move(name_), lib);
+}
 
-            if (!iter_bool.second)
-                throw Error("Invalid data found in file!");
+// Return a Collection with the given name whose members are those in
+// c1 but not in c2.
+Collection Collection::subtract(const Collection& c1, const Collection& c2, string name_, Library& lib)
+{
+    return Collection(Member_set::set_difference(c1.member_list, c2.member_list), move(name_), lib);
+}
 
-            member_list.insert(*iter_bool.first);
-        }
+// Return a Collection with the given name whose members are those in
+// any of the given Collections. The member sets are merged in pairs,
+// then the results in pairs, so each member is merged about log N times
+// instead of once for every Collection after it.
+Collection Collection::combine_all(const vector<const Collection*>& collections, string name_, Library& lib)
+{
+    vector<Member_set> merged;
+    for (size_t i = 0; i + 1 < collections.size(); i += 2)
+        merged.push_back(Member_set::set_union(collections[i]->member_list, collections[i + 1]->member_list));
+    if (collections.size() % 2 != 0)
+        merged.push_back(collections.back()->member_list);
+
+    while (merged.size() > 1) {
+        vector<Member_set> next;
+        for (size_t i = 0; i + 1 < merged.size(); i += 2)
+            next.push_back(Member_set::set_union(merged[i], merged[i + 1]));
+        if (merged.size() % 2 != 0)
+            next.push_back(move(merged.back()));
+        merged.swap(next);
     }
+
+    return Collection(move(merged.front()), move(name_), lib);
 }
 
-// Construct a Collection by combining Collections c1 and c2 and the
-// given name.
-Collection::Collection(const Collection& c1, const Collection& c2, string name_)
+// Construct a Collection with the given members and count their
+// memberships
+Collection::Collection(Member_set members, string name_, Library& lib)
+    : member_list(move(members))
+    , name(move(name_))
 {
-    name = move(name_);
-
-    // Insert c1 and c2's members into the member_list
-    for_each(c1.member_list.cbegin(), c1.member_list.cend(), [&](Record* record) { member_list.insert(record); });
-    for_each(c2.member_list.cbegin(), c2.member_list.cend(), [&](Record* record) { member_list.insert(record); });
+    member_list.for_each([&](uint32_t id) { lib.add_membership(lib.find_id(id)); });
 }
 
-// Add the Record, throw exception if there is already a Record
-// with the same title.
-void Collection::add_member(Record* record_ptr)
+// Add the Record, throw exception if the Record is already a member.
+void Collection::add_member(Record* record_ptr, Library& lib)
 {
-    if (!member_list.insert(record_ptr).second)
+    if (!member_list.insert(record_ptr->get_ID()))
         throw Error("Record is already a member in the collection!");
+    lib.add_membership(record_ptr);
 }
 
 // Return true if the record is present, false if not.
 bool Collection::is_member_present(Record* record_ptr) const
 {
-    if (member_list.find(record_ptr) != member_list.cend())
-        return true;
-    return false;
+    return member_list.contains(record_ptr->get_ID());
 }
 
 // Remove the specified Record, throw exception if the record was not found.
-void Collection::remove_member(Record* record_ptr)
+void Collection::remove_member(Record* record_ptr, Library& lib)
 {
-    Lib_ti_iter it = member_list.find(record_ptr);
-    if (it == member_list.cend())
+    if (!member_list.erase(record_ptr->get_ID()))
         throw Error("Record is not a member in the collection!");
-    member_list.erase(it);
+    lib.remove_membership(record_ptr);
+}
+
+// discard all members
+void Collection::clear(Library& lib)
+{
+    member_list.for_each([&](uint32_t id) { lib.remove_membership(lib.find_id(id)); });
+    member_list.clear();
 }
 
-// Remove old_record in the member_list and insert new_record
-// into the member_list. If old_record does not exist in member_list.
-// do not do anything and return
-void Collection::remove_then_add_member(Record* old_record, Record* new_record)
+// Call func with each member Record in alphabetical order of title. If
+// the members are at least an eighth of the Library, walk the Library's
+// title order and skip the other Records; this allocates nothing, and
+// costs one ID lookup per Record. Otherwise sort the members, allocating a
+// pointer for each, so a small Collection is not charged for the whole
+// Library.
+template <typename F>
+void Collection::for_each_member_by_title(const Library& lib, F func) const
 {
-    Lib_ti_iter it = member_list.find(old_record);
-    if (it == member_list.cend())
+    if (member_list.size() >= lib.size() / library_walk_fraction) {
+        for (Record* record_ptr : lib) {
+            if (member_list.contains(record_ptr->get_ID()))
+                func(record_ptr);
+        }
         return;
-    member_list.erase(it);
-    member_list.insert(new_record);
+    }
+
+    vector<Record*, Counting_allocator<Record*, Memory_category::members>> members;
+    members.reserve(member_list.size());
+    member_list.for_each([&](uint32_t id) { members.push_back(lib.find_id(id)); });
+    sort(members.begin(), members.end(), Title_compare());
+    for_each(members.cbegin(), members.cend(), func);
 }
 
-// Write a Collections's data to a stream in save format, with
-// endl as specified.
-void Collection::save(std::ostream& os) const
+// Write a Collections's data to a stream in save format, one line
+// per member in alphabetical order of title.
+void Collection::save(std::ostream& os, const Library& lib) const
 {
-    os << name << " " << member_list.size() << endl;
+    os << name << " " << member_list.size() << '\n';
 
-    for_each(
-        member_list.cbegin(), member_list.cend(), [&](const Record* record) { os << record->get_title() << endl; });
+    for_each_member_by_title(lib, [&](const Record* record) { os << record->get_title() << '\n'; });
 }
 
-// Print the Collection data
-std::ostream& operator<<(std::ostream& os, const Collection& collection)
+// Print the Collection data, with the members in alphabetical
+// order of title.
+void Collection::print(std::ostream& os, const Library& lib) const
 {
-    os << "Collection " << collection.name << " contains:";
+    os << "Collection " << name << " contains:";
 
-    if (collection.member_list.empty()) {
-        os << " None" << endl;
-        return os;
+    if (member_list.empty()) {
+        os << " None\n";
+        return;
     }
 
-    os << endl;
+    os << '\n';
 
     // Print each member's/record's information
-    ostream_iterator<Record*> out_it(cout);
-    copy(collection.member_list.cbegin(), collection.member_list.cend(), out_it);
-    return os;
-}
\ No newline at end of file
+    for_each_member_by_title(lib, [&](const Record* record) { os << record; });
+}
@@ -0,0 +1,124 @@
+#include "Command_stats.h"
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+// Return the time in microseconds with one decimal place
+string format_time(uint64_t nanoseconds)
+{
+    char text[32];
+    snprintf(text, sizeof(text), "%.1f us", nanoseconds / 1000.0);
+    return text;
+}
+
+}  // namespace
+
+// Make counters for each command in the table
+Command_stats::Command_stats(const Command_table& commands_)
+    : commands(commands_)
+    , counters(new Counters[commands_.size()])
+    , num_unrecognized(0)
+{ }
+
+// Count a run of the command with the index, with how it ended and how
+// long it took
+void Command_stats::record(int index, Outcome outcome, chrono::nanoseconds elapsed)
+{
+    Counters& command_counters = counters[index];
+    uint64_t nanoseconds = max<int64_t>(0, elapsed.count());
+
+    command_counters.num_runs.fetch_add(1, memory_order_relaxed);
+    if (outcome == Outcome::error)
+        command_counters.num_errors.fetch_add(1, memory_order_relaxed);
+    else if (outcome == Outcome::title_error)
+        command_counters.num_title_errors.fetch_add(1, memory_order_relaxed);
+    command_counters.buckets[bucket_of(nanoseconds)].fetch_add(1, memory_order_relaxed);
+
+    uint64_t longest = command_counters.max_nanoseconds.load(memory_order_relaxed);
+    while (nanoseconds > longest
+        && !command_counters.max_nanoseconds.compare_exchange_weak(longest, nanoseconds, memory_order_relaxed)) {
+    }
+}
+
+// Print the counts and the 50th, 90th and 99th percentile and the
+// longest time of each command that ran, then reset the counters. Each
+// counter is read and reset in one step, so no run is lost between the
+// two.
+void Command_stats::print_and_reset(ostream& os)
+{
+    const double percentiles[] = {0.5, 0.9, 0.99};
+    const char* const percentile_names[] = {"p50", "p90", "p99"};
+
+    bool any_run = false;
+    uint64_t buckets[num_buckets];
+    for (int index = 0; index < commands.size(); ++index) {
+        Counters& command_counters = counters[index];
+        uint64_t num_runs = command_counters.num_runs.exchange(0, memory_order_relaxed);
+        uint64_t num_errors = command_counters.num_errors.exchange(0, memory_order_relaxed);
+        uint64_t num_title_errors = command_counters.num_title_errors.exchange(0, memory_order_relaxed);
+        uint64_t longest = command_counters.max_nanoseconds.exchange(0, memory_order_relaxed);
+        uint64_t num_timed = 0;
+        for (int bucket = 0; bucket < num_buckets; ++bucket) {
+            buckets[bucket] = command_counters.buckets[bucket].exchange(0, memory_order_relaxed);
+            num_timed += buckets[bucket];
+        }
+        if (num_runs == 0 || num_timed == 0)
+            continue;
+
+        if (!any_run)
+            os << "Command statistics:\n";
+        any_run = true;
+        os << commands.get_name(index) << ": " << num_runs << " runs, " << num_errors << " errors, "
+           << num_title_errors << " title errors";
+
+        // A percentile is the top of the bucket holding its rank, but
+        // never more than the longest time seen
+        int bucket = 0;
+        uint64_t num_below = buckets[0];
+        for (int i = 0; i < 3; ++i) {
+            uint64_t rank = max<uint64_t>(1, static_cast<uint64_t>(percentiles[i] * num_timed + 0.999999));
+            while (num_below < rank && bucket + 1 < num_buckets)
+                num_below += buckets[++bucket];
+            os << (i == 0 ? "; " : ", ") << percentile_names[i] << " "
+               << format_time(min(bucket_top(bucket), longest));
+        }
+        os << ", max " << format_time(longest) << '\n';
+    }
+
+    uint64_t unrecognized = num_unrecognized.exchange(0, memory_order_relaxed);
+    if (!any_run && unrecognized == 0) {
+        os << "No commands have run\n";
+        return;
+    }
+    if (unrecognized > 0)
+        os << "Unrecognized commands: " << unrecognized << '\n';
+}
+
+// Return the bucket of the time. Times below sub_buckets nanoseconds have
+// a bucket each; above that, the power of two holding the time and the
+// next four bits below its top bit pick the bucket.
+int Command_stats::bucket_of(uint64_t nanoseconds)
+{
+    nanoseconds = min(nanoseconds, (uint64_t(1) << (max_exponent + 1)) - 1);
+    if (nanoseconds < sub_buckets)
+        return static_cast<int>(nanoseconds);
+
+    int exponent = 63 - __builtin_clzll(nanoseconds);
+    int sub_bucket = static_cast<int>(nanoseconds >> (exponent - 4)) - sub_buckets;
+    return (exponent - 3) * sub_buckets + sub_bucket;
+}
+
+// Return the longest time in the bucket
+uint64_t Command_stats::bucket_top(int bucket)
+{
+    if (bucket < sub_buckets)
+        return bucket;
+
+    int exponent = bucket / sub_buckets + 3;
+    int sub_bucket = bucket % sub_buckets;
+    return (uint64_t(sub_buckets + sub_bucket + 1) << (exponent - 4)) - 1;
+}
@@ -0,0 +1,64 @@
+#include "Command_table.h"
+
+using namespace std;
+
+namespace {
+
+const int num_letters = 52;
+
+}  // namespace
+
+// Fill the table from pairs of a two-letter name and its function
+Command_table::Command_table(initializer_list<pair<const char*, Command>> commands)
+    : slots(num_letters * num_letters)
+    , slot_commands(num_letters * num_letters, -1)
+{
+    for (const auto& name_command : commands) {
+        const char* name = name_command.first;
+        int slot = slot_index(name[0], name[1]);
+        slots[slot] = name_command.second;
+        slot_commands[slot] = static_cast<int>(names.size());
+        names.emplace_back(name, 2);
+    }
+}
+
+// Return the command named by the two characters, or nullptr if there
+// is none.
+const Command_table::Command* Command_table::find(char first, char second) const
+{
+    int slot = slot_index(first, second);
+    if (slot < 0)
+        return nullptr;
+
+    const Command& command = slots[slot];
+    return command ? &command : nullptr;
+}
+
+// Return the index of the command named by the two characters, or -1 if
+// there is none.
+int Command_table::find_index(char first, char second) const
+{
+    int slot = slot_index(first, second);
+    return slot < 0 ? -1 : slot_commands[slot];
+}
+
+// Return the letter's place among the lower-case and then the upper-case
+// letters, or -1 if it is not a letter.
+int Command_table::letter_index(char c)
+{
+    if (c >= 'a' && c <= 'z')
+        return c - 'a';
+    if (c >= 'A' && c <= 'Z')
+        return c - 'A' + 26;
+    return -1;
+}
+
+// Return the slot of the two characters, or -1 if either is not a letter
+int Command_table::slot_index(char first, char second)
+{
+    int first_index = letter_index(first);
+    int second_index = letter_index(second);
+    if (first_index < 0 || second_index < 0)
+        return -1;
+    return first_index * num_letters + second_index;
+}
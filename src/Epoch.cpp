@@ -0,0 +1,121 @@
+#include "Epoch.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// The epoch a thread's guard entered, or 0 outside any guard
+struct Reader_slot
+{
+    atomic<uint64_t> epoch{0};
+    int depth = 0;
+};
+
+struct Retired
+{
+    void* ptr;
+    void (*deleter)(void*);
+    uint64_t epoch;
+};
+
+// Epochs start at 1, since 0 marks a thread outside any guard
+atomic<uint64_t> current_epoch{1};
+
+// The slots of the threads that have entered a guard
+mutex slots_mutex;
+vector<Reader_slot*> slots;
+
+// Memory retired since the last reclaim_retired, and memory stamped
+// with an epoch in the order of stamping
+mutex retired_mutex;
+vector<Retired> pending;
+deque<Retired> retired;
+
+// Adds the thread's slot to the list when the thread first enters a
+// guard, and removes it when the thread ends
+struct Slot_registration
+{
+    Slot_registration()
+    {
+        lock_guard<mutex> lock(slots_mutex);
+        slots.push_back(&slot);
+    }
+    ~Slot_registration()
+    {
+        lock_guard<mutex> lock(slots_mutex);
+        slots.erase(find(slots.begin(), slots.end(), &slot));
+    }
+
+    Reader_slot slot;
+};
+
+thread_local Slot_registration registration;
+
+}  // namespace
+
+// Enter the current epoch; guards on one thread may nest
+Epoch_guard::Epoch_guard()
+{
+    Reader_slot& slot = registration.slot;
+    if (slot.depth++ == 0)
+        slot.epoch.store(current_epoch.load());
+}
+
+// Leave the epoch, unless an outer guard on this thread remains
+Epoch_guard::~Epoch_guard()
+{
+    Reader_slot& slot = registration.slot;
+    if (--slot.depth == 0)
+        slot.epoch.store(0);
+}
+
+// Hand over memory that readers may still see, to be freed with the
+// deleter once none can.
+void retire(void* ptr, void (*deleter)(void*))
+{
+    lock_guard<mutex> lock(retired_mutex);
+    pending.push_back(Retired{ptr, deleter, 0});
+}
+
+// Called after a writer publishes new data. Stamp the memory retired
+// since the last call with the current epoch, move to the next epoch,
+// and free what no reader can still see: memory stamped before the
+// oldest epoch a reader is in.
+void reclaim_retired()
+{
+    lock_guard<mutex> lock(retired_mutex);
+    uint64_t epoch = current_epoch.fetch_add(1);
+    for (Retired& item : pending) {
+        item.epoch = epoch;
+        retired.push_back(item);
+    }
+    pending.clear();
+
+    uint64_t oldest_active = UINT64_MAX;
+    {
+        lock_guard<mutex> slots_lock(slots_mutex);
+        for (const Reader_slot* slot : slots) {
+            uint64_t slot_epoch = slot->epoch.load();
+            if (slot_epoch != 0)
+                oldest_active = min(oldest_active, slot_epoch);
+        }
+    }
+
+    while (!retired.empty() && retired.front().epoch < oldest_active) {
+        retired.front().deleter(retired.front().ptr);
+        retired.pop_front();
+    }
+}
+
+// Return the current epoch. Memory a writer made in the current epoch
+// has not been published yet, so the writer may still change it in place.
+uint64_t get_epoch()
+{
+    return current_epoch.load();
+}
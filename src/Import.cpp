@@ -0,0 +1,207 @@
+#include "Import.h"
+#include "Mapped_file.h"
+#include "Utility.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <deque>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// Return the text without leading and trailing whitespace
+string_view trim_white(string_view text)
+{
+    while (!text.empty() && isspace(static_cast<unsigned char>(text.front())))
+        text.remove_prefix(1);
+    while (!text.empty() && isspace(static_cast<unsigned char>(text.back())))
+        text.remove_suffix(1);
+    return text;
+}
+
+// Return true if the text equals the lower-case name, ignoring case
+bool equals_ignoring_case(string_view text, string_view name)
+{
+    if (text.size() != name.size())
+        return false;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (tolower(static_cast<unsigned char>(text[i])) != name[i])
+            return false;
+    }
+    return true;
+}
+
+// Reads the fields of one line at a time from the mapped file. A field
+// is a view into the file, unless it was quoted and had to be unescaped;
+// such fields are copied into a deque, where they stay in place while
+// more are added.
+class Field_reader
+{
+public:
+    Field_reader(const char* begin_, const char* end_, char separator_, deque<string>& copies_)
+        : pos(begin_)
+        , end(end_)
+        , separator(separator_)
+        , copies(copies_)
+    { }
+
+    bool at_end() const
+    {
+        return pos == end;
+    }
+
+    // Read the fields of the next line and move past its end.
+    // Throw an Error if a quoted field is not closed on its line.
+    void read_line(vector<string_view>& fields)
+    {
+        fields.clear();
+        while (true) {
+            if (pos != end && *pos == '"')
+                fields.push_back(read_quoted());
+            else
+                fields.push_back(read_plain());
+
+            if (pos == end)
+                return;
+            if (*pos == separator) {
+                ++pos;
+                continue;
+            }
+            if (*pos == '\r')
+                ++pos;
+            if (pos != end && *pos == '\n')
+                ++pos;
+            return;
+        }
+    }
+
+private:
+    string_view read_plain()
+    {
+        const char* field_end = pos;
+        while (field_end != end && *field_end != separator && *field_end != '\n')
+            ++field_end;
+
+        string_view field(pos, field_end - pos);
+        if (!field.empty() && field.back() == '\r') {
+            field.remove_suffix(1);
+            --field_end;
+        }
+        pos = field_end;
+        return field;
+    }
+
+    string_view read_quoted()
+    {
+        string value;
+        ++pos;
+        while (true) {
+            if (pos == end || *pos == '\n')
+                throw Error("Invalid data found in file!");
+            if (*pos == '"') {
+                ++pos;
+                if (pos == end || *pos != '"')
+                    break;
+            }
+            value.push_back(*pos++);
+        }
+
+        // Only a separator or the end of the line may follow the quote
+        if (pos != end && *pos != separator && *pos != '\r' && *pos != '\n')
+            throw Error("Invalid data found in file!");
+
+        copies.push_back(move(value));
+        return copies.back();
+    }
+
+    const char* pos;
+    const char* end;
+    char separator;
+    deque<string>& copies;
+};
+
+// Return true if the fields name the columns rather than hold a Record
+bool is_header(const vector<string_view>& fields)
+{
+    return fields.size() >= 2 && equals_ignoring_case(trim_white(fields[0]), "medium")
+        && equals_ignoring_case(trim_white(fields[1]), "title")
+        && (fields.size() == 2 || equals_ignoring_case(trim_white(fields[2]), "rating"));
+}
+
+// Make a Record_row from the fields of a line. A title that needs to be
+// cleaned up is copied into the deque. Throw an Error if the fields do
+// not hold a valid Record.
+Record_row make_row(const vector<string_view>& fields, deque<string>& copies)
+{
+    if (fields.size() != 2 && fields.size() != 3)
+        throw Error("Invalid data found in file!");
+
+    string_view medium = trim_white(fields[0]);
+    for (char c : medium) {
+        if (isspace(static_cast<unsigned char>(c)))
+            throw Error("Invalid data found in file!");
+    }
+
+    string_view title = fields[1];
+    if (!is_free_of_unneeded_white(title)) {
+        copies.push_back(remove_unneeded_white(title));
+        title = copies.back();
+    }
+
+    if (medium.empty() || title.empty())
+        throw Error("Invalid data found in file!");
+
+    int rating = 0;
+    if (fields.size() == 3) {
+        string_view rating_field = trim_white(fields[2]);
+        if (!rating_field.empty()) {
+            const char* rating_end = rating_field.data() + rating_field.size();
+            from_chars_result result = from_chars(rating_field.data(), rating_end, rating);
+            if (result.ec != errc() || result.ptr != rating_end || rating < 1 || rating > 5)
+                throw Error("Invalid data found in file!");
+        }
+    }
+
+    return Record_row{0, medium, title, rating};
+}
+
+}  // namespace
+
+// Import the Records in the named file into the Library. Throw an Error
+// if the file cannot be opened or a row is invalid.
+Import_result import_records(const string& file_name, Library& lib)
+{
+    Mapped_file file(file_name);
+
+    const string tsv_extension = ".tsv";
+    bool is_tsv = file_name.size() > tsv_extension.size()
+        && file_name.compare(file_name.size() - tsv_extension.size(), tsv_extension.size(), tsv_extension) == 0;
+
+    deque<string> copies;
+    Field_reader reader(file.begin(), file.end(), is_tsv ? '\t' : ',', copies);
+
+    vector<Record_row> rows;
+    vector<string_view> fields;
+    bool first_line = true;
+    while (!reader.at_end()) {
+        reader.read_line(fields);
+
+        if (fields.size() == 1 && trim_white(fields[0]).empty())
+            continue;
+        if (first_line && is_header(fields)) {
+            first_line = false;
+            continue;
+        }
+        first_line = false;
+
+        rows.push_back(make_row(fields, copies));
+    }
+
+    vector<Record*> created = lib.add_records(rows);
+    int num_duplicate = static_cast<int>(count(created.begin(), created.end(), nullptr));
+    return Import_result{static_cast<int>(rows.size()) - num_duplicate, num_duplicate};
+}
@@ -0,0 +1,175 @@
+#include "Input_reader.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+// Input is read this many bytes at a time to start with; the buffer
+// only grows to hold a longer word or line.
+const size_t block_size = 1 << 16;
+
+bool is_white(char c)
+{
+    return isspace(static_cast<unsigned char>(c));
+}
+
+}  // namespace
+
+// Read from the open file descriptor
+Input_reader::Input_reader(int fd_)
+    : fd(fd_)
+    , at_eof(false)
+    , buffer(block_size)
+    , pos(0)
+    , end(0)
+{ }
+
+// Read the given text only
+Input_reader::Input_reader(string_view text)
+    : fd(-1)
+    , at_eof(true)
+    , buffer(text.begin(), text.end())
+    , pos(0)
+    , end(text.size())
+{ }
+
+// Read the next non-whitespace character. Return false at the end of
+// the input.
+bool Input_reader::read_char(char& c)
+{
+    skip_white();
+    if (pos == end)
+        return false;
+    c = buffer[pos++];
+    return true;
+}
+
+// Read the next run of non-whitespace characters. Return an empty view
+// at the end of the input.
+string_view Input_reader::read_word()
+{
+    skip_white();
+    size_t size = scan([](char c) { return !is_white(c); });
+    string_view word(buffer.data() + pos, size);
+    pos += size;
+    return word;
+}
+
+// Read an optionally signed decimal integer after any whitespace.
+// Return false, consuming nothing more, if there is none or it does not
+// fit in an int.
+bool Input_reader::read_int(int& value)
+{
+    skip_white();
+    bool first = true;
+    size_t size = scan([&first](char c) {
+        bool is_part = isdigit(static_cast<unsigned char>(c)) || (first && (c == '-' || c == '+'));
+        first = false;
+        return is_part;
+    });
+
+    // from_chars takes a minus sign but not a plus sign
+    const char* begin = buffer.data() + pos;
+    const char* last = begin + size;
+    if (size > 0 && *begin == '+')
+        ++begin;
+    from_chars_result result = from_chars(begin, last, value);
+    if (result.ec != errc() || result.ptr != last)
+        return false;
+
+    pos += size;
+    return true;
+}
+
+// Read the rest of the current line and move past its newline
+string_view Input_reader::read_line()
+{
+    size_t size = scan([](char c) { return c != '\n'; });
+    string_view line(buffer.data() + pos, size);
+    pos += size;
+    if (pos != end)
+        ++pos;
+    return line;
+}
+
+// Discard the rest of the current line and its newline. The buffer does
+// not have to hold the whole line, so it is discarded as it is read.
+void Input_reader::skip_line()
+{
+    while (true) {
+        auto newline = find(buffer.begin() + pos, buffer.begin() + end, '\n');
+        if (newline != buffer.begin() + end) {
+            pos = newline - buffer.begin() + 1;
+            return;
+        }
+        pos = end;
+        if (!fill())
+            return;
+    }
+}
+
+// Skip the whitespace already read in and return true if more input is
+// waiting in the buffer, so that reading it will not block.
+bool Input_reader::has_buffered_input()
+{
+    while (pos != end && is_white(buffer[pos]))
+        ++pos;
+    return pos != end;
+}
+
+// Skip whitespace, reading more input as needed
+void Input_reader::skip_white()
+{
+    do {
+        while (pos != end && is_white(buffer[pos]))
+            ++pos;
+    } while (pos == end && fill());
+}
+
+// Return the length of the run of characters from the current position
+// for which pred is true, reading more input as needed. Filling moves
+// the unread input to the front, so the length stays correct.
+template <typename P>
+size_t Input_reader::scan(P pred)
+{
+    size_t size = 0;
+    while (true) {
+        while (pos + size != end && pred(buffer[pos + size]))
+            ++size;
+        if (pos + size != end || !fill())
+            return size;
+    }
+}
+
+// Move the unread input to the front of the buffer, growing it if it is
+// full, and read more after it. Return false if there is no more.
+bool Input_reader::fill()
+{
+    if (at_eof)
+        return false;
+
+    if (pos > 0) {
+        copy(buffer.begin() + pos, buffer.begin() + end, buffer.begin());
+        end -= pos;
+        pos = 0;
+    }
+    if (end == buffer.size())
+        buffer.resize(buffer.size() * 2);
+
+    ssize_t size;
+    do
+        size = read(fd, buffer.data() + end, buffer.size() - end);
+    while (size < 0 && errno == EINTR);
+
+    if (size <= 0) {
+        at_eof = true;
+        return false;
+    }
+    end += size;
+    return true;
+}
@@ -0,0 +1,279 @@
+#include "Journal.h"
+#include "Mapped_file.h"
+#include "Snapshot.h"
+#include "Utility.h"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iomanip>
+#include <sstream>
+#include <string_view>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+// Buffered changes are written once this many have built up, even
+// while more input is waiting
+const int max_group_size = 64;
+
+// A checkpoint is taken after this many changes
+const int checkpoint_interval = 10000;
+
+// Return the FNV-1a checksum of the text
+uint32_t line_checksum(string_view text)
+{
+    uint32_t hash = 2166136261u;
+    for (char c : text) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Return the text as a journal line: its checksum in hex, a space, the
+// text, and a newline
+string make_line(string_view text)
+{
+    char checksum[9];
+    snprintf(checksum, sizeof(checksum), "%08x", line_checksum(text));
+    string line(checksum);
+    line += ' ';
+    line += text;
+    line += '\n';
+    return line;
+}
+
+// Find the text of a journal line without its newline. Return false if
+// the line is malformed or its checksum does not match.
+bool parse_line(string_view line, string_view& text)
+{
+    if (line.size() < 9 || line[8] != ' ')
+        return false;
+
+    uint32_t checksum = 0;
+    for (int i = 0; i < 8; ++i) {
+        int digit;
+        if (line[i] >= '0' && line[i] <= '9')
+            digit = line[i] - '0';
+        else if (line[i] >= 'a' && line[i] <= 'f')
+            digit = line[i] - 'a' + 10;
+        else
+            return false;
+        checksum = checksum << 4 | digit;
+    }
+
+    text = line.substr(9);
+    return line_checksum(text) == checksum;
+}
+
+// Write all of the data, retrying short writes. Throw an Error on failure.
+void write_all(int fd, const char* data, size_t size)
+{
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0)
+            throw Error("Could not write to journal!");
+        data += written;
+        size -= written;
+    }
+}
+
+// Flush the named file or directory to the disk. Throw an Error on failure.
+void sync_path(const string& name)
+{
+    if (!sync_to_disk(name))
+        throw Error("Could not write to journal!");
+}
+
+// Rename the file, throwing an Error on failure
+void rename_file(const string& from, const string& to)
+{
+    if (rename(from.c_str(), to.c_str()) != 0)
+        throw Error("Could not write to journal!");
+}
+
+}  // namespace
+
+// The checkpoint is kept next to the journal, in the file with the
+// journal's name followed by ".checkpoint".
+Journal::Journal(const string& file_name_)
+    : file_name(file_name_)
+    , checkpoint_name(file_name_ + ".checkpoint")
+    , fd(-1)
+    , num_buffered(0)
+    , num_since_checkpoint(0)
+{ }
+
+// Write any changes still in the buffer
+Journal::~Journal()
+{
+    try {
+        if (fd >= 0)
+            sync();
+    } catch (Error&) {
+    }
+    if (fd >= 0)
+        close(fd);
+}
+
+// Load the latest checkpoint into the given empty Library and Catalog
+// and return the changes made since, in order. If there is no journal
+// yet, start one with a checkpoint of the empty Library and Catalog.
+vector<string> Journal::recover(Library& lib, Catalog& cat)
+{
+    if (access(file_name.c_str(), F_OK) != 0) {
+        checkpoint(lib, cat);
+        return {};
+    }
+
+    // Take the lines up to the first one that is cut short or damaged
+    vector<string> texts;
+    size_t valid_size = 0, file_size = 0;
+    {
+        Mapped_file file(file_name);
+        file_size = file.end() - file.begin();
+        const char* pos = file.begin();
+        while (pos != file.end()) {
+            const char* newline = static_cast<const char*>(memchr(pos, '\n', file.end() - pos));
+            string_view text;
+            if (newline == nullptr || !parse_line(string_view(pos, newline - pos), text))
+                break;
+            texts.emplace_back(text);
+            pos = newline + 1;
+        }
+        valid_size = pos - file.begin();
+    }
+
+    // The first line names the checkpoint and the next Record ID
+    istringstream header(texts.empty() ? string() : texts.front());
+    string word;
+    uint64_t checksum;
+    int next_id;
+    header >> word >> hex >> checksum >> dec >> next_id;
+    if (!header || word != "checkpoint")
+        throw Error("Invalid data found in journal!");
+
+    // A crash while the last checkpoint was being taken may have left it
+    // under its temporary name; if so, finish putting it in place
+    if (!load_checkpoint(checkpoint_name, checksum, lib, cat)) {
+        string temp_name = checkpoint_name + ".tmp";
+        if (!load_checkpoint(temp_name, checksum, lib, cat))
+            throw Error("Could not find the journal's checkpoint!");
+        rename_file(temp_name, checkpoint_name);
+        sync_path(directory_of(file_name));
+    }
+
+    if (next_id < lib.get_next_id())
+        throw Error("Invalid data found in journal!");
+    lib.set_next_id(next_id);
+
+    if (valid_size != file_size && truncate(file_name.c_str(), valid_size) != 0)
+        throw Error("Could not write to journal!");
+
+    open_for_append();
+    texts.erase(texts.begin());
+    num_since_checkpoint = texts.size();
+    return texts;
+}
+
+// Add a change to the buffer
+void Journal::append(const string& change)
+{
+    buffer += make_line(change);
+    ++num_buffered;
+    ++num_since_checkpoint;
+}
+
+// Called after each command; writes and syncs the buffer unless more
+// input is waiting and the group is still small.
+void Journal::end_command(bool more_input)
+{
+    if (num_buffered > 0 && (!more_input || num_buffered >= max_group_size))
+        sync();
+}
+
+// Write and sync the buffered changes.
+void Journal::sync()
+{
+    if (buffer.empty())
+        return;
+
+    write_all(fd, buffer.data(), buffer.size());
+    if (fdatasync(fd) != 0)
+        throw Error("Could not write to journal!");
+    buffer.clear();
+    num_buffered = 0;
+}
+
+// Return true once enough changes have been made since the last
+// checkpoint that it is time for another.
+bool Journal::is_checkpoint_due() const
+{
+    return num_since_checkpoint >= checkpoint_interval;
+}
+
+// Write a checkpoint of the Library and Catalog and start a new, empty
+// journal. Both are written under temporary names and synced, then the
+// journal is renamed into place before the checkpoint.
+void Journal::checkpoint(const Library& lib, const Catalog& cat)
+{
+    // The current journal must hold every change in case this fails
+    if (fd >= 0)
+        sync();
+
+    string temp_checkpoint = checkpoint_name + ".tmp";
+    uint64_t checksum = save_binary_snapshot(temp_checkpoint, lib, cat);
+    sync_path(temp_checkpoint);
+
+    ostringstream header;
+    header << "checkpoint " << hex << setw(16) << setfill('0') << checksum << dec << ' ' << lib.get_next_id();
+    string header_line = make_line(header.str());
+
+    string temp_journal = file_name + ".tmp";
+    int temp_fd = open(temp_journal.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (temp_fd < 0)
+        throw Error("Could not write to journal!");
+    try {
+        write_all(temp_fd, header_line.data(), header_line.size());
+        if (fsync(temp_fd) != 0)
+            throw Error("Could not write to journal!");
+    } catch (Error&) {
+        close(temp_fd);
+        throw;
+    }
+    close(temp_fd);
+
+    rename_file(temp_journal, file_name);
+    open_for_append();
+    num_since_checkpoint = 0;
+
+    rename_file(temp_checkpoint, checkpoint_name);
+    sync_path(directory_of(file_name));
+}
+
+// Load the checkpoint with the checksum into the empty Library and
+// Catalog. Return false, leaving them empty, if the file is missing,
+// invalid, or a different checkpoint.
+bool Journal::load_checkpoint(const string& name, uint64_t checksum, Library& lib, Catalog& cat)
+{
+    try {
+        if (restore_binary_snapshot(name, lib, cat) == checksum)
+            return true;
+    } catch (Error&) {
+    }
+    cat.clear(lib);
+    lib.clear();
+    return false;
+}
+
+// Open the journal for appending
+void Journal::open_for_append()
+{
+    if (fd >= 0)
+        close(fd);
+    fd = open(file_name.c_str(), O_WRONLY | O_APPEND);
+    if (fd < 0)
+        throw Error("Could not write to journal!");
+}
@@ -0,0 +1,371 @@
+#include "Library.h"
+#include "Epoch.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <utility>
+
+using namespace std;
+
+namespace {
+
+// The most bytes of freed titles that wait for a publication
+const size_t max_unretired_bytes = 1 << 20;
+
+// Return the version's tree for the rating. Ratings are checked where
+// Records are read, so one out of range here is a bug.
+Entry_tree& rating_tree(Library_version& version, int rating)
+{
+    assert(rating >= 0 && rating < Library_version::num_ratings);
+    return version.by_rating[rating];
+}
+
+// Add the Records, already in the set's order, to the set. A few Records
+// are inserted one at a time; many are merged with the set in a single
+// linear pass, each one going in at the end of the merged set.
+template <typename Set>
+void insert_sorted(Set& set, const vector<Record*>& sorted)
+{
+    if (sorted.size() * log2(set.size() + 2) < set.size()) {
+        for (Record* record_ptr : sorted)
+            set.insert(record_ptr);
+        return;
+    }
+
+    Set merged(set.key_comp());
+    merge(set.begin(), set.end(), sorted.begin(), sorted.end(), inserter(merged, merged.end()), set.key_comp());
+    set.swap(merged);
+}
+
+// Return the indexes 0 to n - 1 in alphabetical order of the titles
+// given by title_of, keeping equal titles in order of index. Most
+// comparisons are settled by the title prefixes kept next to the
+// indexes, without reading the titles themselves.
+template <typename F>
+vector<size_t> title_order(size_t n, F title_of)
+{
+    vector<pair<uint64_t, size_t>> keyed(n);
+    for (size_t i = 0; i < n; ++i)
+        keyed[i] = make_pair(title_prefix(title_of(i)), i);
+    sort(keyed.begin(), keyed.end(), [&](const pair<uint64_t, size_t>& k1, const pair<uint64_t, size_t>& k2) {
+        if (k1.first != k2.first)
+            return k1.first < k2.first;
+        int result = title_of(k1.second).compare(title_of(k2.second));
+        return result != 0 ? result < 0 : k1.second < k2.second;
+    });
+
+    vector<size_t> order(n);
+    transform(keyed.begin(), keyed.end(), order.begin(), [](const pair<uint64_t, size_t>& k) { return k.second; });
+    return order;
+}
+
+}  // namespace
+
+// An empty version is published from the start
+Library::Library()
+    : published(new Library_version)
+    , is_changed(false)
+    , next_id(1)
+    , total_memberships(0)
+    , num_in_at_least_one(0)
+    , num_in_more_than_one(0)
+{ }
+
+// The Library's Records are released along with its arena as soon as
+// no reader can see them. A Library that takes its place in the
+// readers' view must be published first.
+Library::~Library()
+{
+    for (Entry_tree& tree : working.by_rating)
+        tree.clear();
+    retire(new Record_arena(std::move(arena)));
+    retire(published.load());
+    reclaim_retired();
+}
+
+// A moved-from Library is left empty
+Library::Library(Library&& other)
+    : Library()
+{
+    swap(other);
+}
+
+Library& Library::operator=(Library&& other)
+{
+    clear();
+    swap(other);
+    return *this;
+}
+
+// Return the Record with the given title, or nullptr if there is none.
+Record* Library::find_title(string_view title) const
+{
+    pair<Lib_ti_iter, bool> iter_bool = lib_binary_search(lib_ti, title);
+    return iter_bool.second ? *iter_bool.first : nullptr;
+}
+
+// Create a Record with the next ID number and add it to the Library.
+// Return nullptr if a Record with the same title already exists.
+Record* Library::add_record(string_view medium, string_view title)
+{
+    pair<Lib_ti_iter, bool> iter_bool = lib_binary_search(lib_ti, title);
+    if (iter_bool.second)
+        return nullptr;
+
+    Record* new_record = arena.create(next_id, medium, title, 0);
+    lib_id.insert(new_record);
+    lib_ti.insert(iter_bool.first, new_record);
+    lib_search.insert(new_record);
+    rating_tree(working, 0).insert(make_entry(new_record));
+    is_changed = true;
+    ++next_id;
+    return new_record;
+}
+
+// Create Records from the rows with the next ID numbers, in the order
+// of the rows, and add them to the indexes in bulk. A row whose title
+// is already in the Library, or in an earlier row, is skipped.
+// Return the Record created for each row, or nullptr if it was skipped.
+vector<Record*> Library::add_records(const vector<Record_row>& rows)
+{
+    // Put the rows in title order, so that duplicates are next to each
+    // other and the Library's titles can be checked in one walk.
+    vector<size_t> order = title_order(rows.size(), [&](size_t i) { return rows[i].title; });
+
+    vector<bool> keep(rows.size(), false);
+    auto lib_iter = lib_ti.cbegin();
+    for (size_t k = 0; k < order.size(); ++k) {
+        string_view title = rows[order[k]].title;
+        if (k > 0 && rows[order[k - 1]].title == title)
+            continue;
+        while (lib_iter != lib_ti.cend() && (*lib_iter)->get_title() < title)
+            ++lib_iter;
+        keep[order[k]] = lib_iter == lib_ti.cend() || (*lib_iter)->get_title() != title;
+    }
+
+    // Create the Records in the order of the rows so that their IDs
+    // follow it
+    vector<Record*> created(rows.size(), nullptr);
+    for (size_t i = 0; i < rows.size(); ++i) {
+        if (!keep[i])
+            continue;
+        Record* new_record = arena.create(next_id++, rows[i].medium, rows[i].title, rows[i].rating);
+        lib_id.insert(new_record);
+        lib_search.insert(new_record);
+        created[i] = new_record;
+    }
+
+    vector<Record*> by_title;
+    for (size_t i : order) {
+        if (created[i] != nullptr)
+            by_title.push_back(created[i]);
+    }
+    // The trees are rebuilt under the same rule as the sets are merged
+    if (by_title.size() * log2(lib_ti.size() + 2) < lib_ti.size()) {
+        for (Record* record_ptr : by_title)
+            rating_tree(working, record_ptr->get_rating()).insert(make_entry(record_ptr));
+        insert_sorted(lib_ti, by_title);
+    } else {
+        insert_sorted(lib_ti, by_title);
+        rebuild_version();
+    }
+    is_changed = true;
+    return created;
+}
+
+// Add restored Records, which already have ID numbers, to the empty
+// Library. The Records are created one after another, then the title
+// and search indexes, which are independent of each other, are built
+// at the same time on their own threads, and the version's rating trees
+// are built from the title order. Return false, leaving
+// the Library empty, if an ID is less than 1 or the largest int, or an
+// ID or title appears twice.
+bool Library::restore_records(const vector<Record_row>& rows)
+{
+    vector<Record*> created;
+    created.reserve(rows.size());
+    for (const Record_row& row : rows) {
+        Record* new_record = arena.create(row.id, row.medium, row.title, row.rating);
+        if (row.id == numeric_limits<int>::max() || !lib_id.insert(new_record)) {
+            clear();
+            return false;
+        }
+        created.push_back(new_record);
+        next_id = max(next_id, row.id + 1);
+    }
+
+    bool titles_unique = true;
+    auto index_titles = [&] {
+        vector<size_t> order = title_order(created.size(), [&](size_t i) { return created[i]->get_title(); });
+        vector<Record*> by_title;
+        by_title.reserve(order.size());
+        for (size_t i : order) {
+            if (!by_title.empty() && by_title.back()->get_title() == created[i]->get_title())
+                titles_unique = false;
+            by_title.push_back(created[i]);
+        }
+        insert_sorted(lib_ti, by_title);
+    };
+    // The search index appends to its posting lists when IDs arrive in
+    // increasing order, so it is fed from the ID index rather than in
+    // the order of the rows, which is usually by title.
+    auto index_search = [&] {
+        for (Record* record_ptr : lib_id)
+            lib_search.insert(record_ptr);
+    };
+    parallel_invoke({index_titles, index_search});
+
+    if (!titles_unique) {
+        clear();
+        return false;
+    }
+    rebuild_version();
+    is_changed = true;
+    return true;
+}
+
+// Give the Record a new rating, keeping the rating order up to date.
+void Library::set_rating(Record* record_ptr, int rating)
+{
+    if (record_ptr->rating == rating)
+        return;
+
+    rating_tree(working, record_ptr->rating).erase(record_ptr->title);
+    record_ptr->rating = rating;
+    rating_tree(working, rating).insert(make_entry(record_ptr));
+    is_changed = true;
+}
+
+// Give the Record a new title. Return false if the title is taken.
+bool Library::retitle_record(Record* record_ptr, string_view title)
+{
+    if (find_title(title) != nullptr)
+        return false;
+
+    lib_ti.erase(record_ptr);
+    lib_search.erase(record_ptr);
+    rating_tree(working, record_ptr->rating).erase(record_ptr->title);
+    string_view old_title = record_ptr->title;
+    record_ptr->title = arena.store_string(title);
+    arena.free_string(old_title);
+    lib_ti.insert(record_ptr);
+    lib_search.insert(record_ptr);
+    rating_tree(working, record_ptr->rating).insert(make_entry(record_ptr));
+    is_changed = true;
+    publish_if_many_freed();
+    return true;
+}
+
+// Remove the Record from the Library and delete it.
+void Library::remove_record(Record* record_ptr)
+{
+    lib_ti.erase(record_ptr);
+    lib_id.erase(record_ptr->get_ID());
+    lib_search.erase(record_ptr);
+    rating_tree(working, record_ptr->rating).erase(record_ptr->title);
+    arena.free_string(record_ptr->title);
+    arena.destroy(record_ptr);
+    is_changed = true;
+    publish_if_many_freed();
+}
+
+// Delete all Records, releasing the whole arena in one step, and
+// start ID numbers from 1 again. Readers may still see the arena's
+// strings in the published version, so it is retired rather than freed.
+void Library::clear()
+{
+    lib_ti.clear();
+    lib_id.clear();
+    lib_search.clear();
+    for (Entry_tree& tree : working.by_rating)
+        tree.clear();
+    retire(new Record_arena(std::move(arena)));
+    is_changed = true;
+    next_id = 1;
+    total_memberships = 0;
+    num_in_at_least_one = 0;
+    num_in_more_than_one = 0;
+}
+
+// Count one more Collection that the Record belongs to.
+void Library::add_membership(Record* record_ptr)
+{
+    int count = ++record_ptr->num_collections;
+    ++total_memberships;
+    is_changed = true;
+    if (count == 1)
+        ++num_in_at_least_one;
+    else if (count == 2)
+        ++num_in_more_than_one;
+}
+
+// Count one less Collection that the Record belongs to.
+void Library::remove_membership(Record* record_ptr)
+{
+    int count = --record_ptr->num_collections;
+    --total_memberships;
+    is_changed = true;
+    if (count == 0)
+        --num_in_at_least_one;
+    else if (count == 1)
+        --num_in_more_than_one;
+}
+
+void Library::swap(Library& other)
+{
+    lib_ti.swap(other.lib_ti);
+    lib_id.swap(other.lib_id);
+    lib_search.swap(other.lib_search);
+    arena.swap(other.arena);
+    std::swap(next_id, other.next_id);
+    std::swap(total_memberships, other.total_memberships);
+    std::swap(num_in_at_least_one, other.num_in_at_least_one);
+    std::swap(num_in_more_than_one, other.num_in_more_than_one);
+    std::swap(working, other.working);
+    is_changed = true;
+    other.is_changed = true;
+}
+
+// Make the changes since the last call visible to readers by publishing
+// a copy of the working version, which shares its trees' nodes. The old
+// version is retired, and the epoch moves on so that the working
+// version's nodes are copied before they are next changed.
+void Library::publish()
+{
+    if (!is_changed)
+        return;
+
+    working.size = size();
+    working.total_memberships = total_memberships;
+    working.num_in_at_least_one = num_in_at_least_one;
+    working.num_in_more_than_one = num_in_more_than_one;
+    retire(published.exchange(new Library_version(working)));
+    arena.retire_freed_strings();
+    is_changed = false;
+    reclaim_retired();
+}
+
+// Publish if many titles were freed since the last publication. Their
+// bytes are reused only after one, and outside the server publishing
+// waits for a command that reads the published version.
+void Library::publish_if_many_freed()
+{
+    if (arena.get_bytes_unretired() >= max_unretired_bytes)
+        publish();
+}
+
+// Rebuild the working version's trees from the title order
+void Library::rebuild_version()
+{
+    vector<Record_entry> by_rating[Library_version::num_ratings];
+    for (const Record* record_ptr : lib_ti) {
+        assert(record_ptr->get_rating() >= 0 && record_ptr->get_rating() < Library_version::num_ratings);
+        by_rating[record_ptr->get_rating()].push_back(make_entry(record_ptr));
+    }
+    for (int rating = 0; rating < Library_version::num_ratings; ++rating)
+        rating_tree(working, rating).assign(by_rating[rating]);
+}
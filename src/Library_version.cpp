@@ -0,0 +1,400 @@
+#include "Library_version.h"
+#include "Epoch.h"
+#include "Memory_usage.h"
+#include "Utility.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+// The most entries or children a node holds
+const int node_capacity = 32;
+
+// How full a node built from sorted entries is, leaving room to insert
+const int build_fill = node_capacity * 3 / 4;
+
+// Insert the value at the position of an array holding count values
+template <typename T>
+void insert_at(T* array, int count, int pos, const T& value)
+{
+    copy_backward(array + pos, array + count, array + count + 1);
+    array[pos] = value;
+}
+
+// Remove the value at the position of an array holding count values
+template <typename T>
+void erase_at(T* array, int count, int pos)
+{
+    copy(array + pos + 1, array + count, array + pos);
+}
+
+}  // namespace
+
+// Each node keeps the prefixes of the titles it orders by, which settle
+// most comparisons without reading the titles themselves from the arena.
+struct Entry_tree::Node
+{
+    // Leaves and inner nodes count their memory as the versions'
+    static void* operator new(size_t size)
+    {
+        count_allocation(Memory_category::versions, size);
+        return ::operator new(size);
+    }
+    static void operator delete(void* ptr, size_t size)
+    {
+        count_deallocation(Memory_category::versions, size);
+        ::operator delete(ptr);
+    }
+
+    uint64_t epoch;
+    int count;
+    bool is_leaf;
+    uint64_t prefixes[node_capacity];
+};
+
+struct Entry_tree::Leaf : Node
+{
+    Record_entry entries[node_capacity];
+};
+
+struct Entry_tree::Inner : Node
+{
+    // The first title under each child
+    string_view first_titles[node_capacity];
+    Node* children[node_capacity];
+};
+
+namespace {
+
+using Node = Entry_tree::Node;
+using Leaf = Entry_tree::Leaf;
+using Inner = Entry_tree::Inner;
+
+string_view first_title(const Node* node)
+{
+    if (node->is_leaf)
+        return static_cast<const Leaf*>(node)->entries[0].title;
+    return static_cast<const Inner*>(node)->first_titles[0];
+}
+
+// Return the place of the first of the node's titles that is not less
+// than the title with the prefix. title_of gives the title at a place.
+template <typename F>
+int lower_place(const Node* node, uint64_t prefix, string_view title, F title_of)
+{
+    int low = 0;
+    int high = node->count;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        uint64_t mid_prefix = node->prefixes[mid];
+        if (mid_prefix < prefix || (mid_prefix == prefix && title_of(mid) < title))
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+int entry_place(const Leaf* leaf, uint64_t prefix, string_view title)
+{
+    return lower_place(leaf, prefix, title, [leaf](int place) { return leaf->entries[place].title; });
+}
+
+template <typename N>
+N* make_node(bool is_leaf)
+{
+    N* node = new N;
+    node->epoch = get_epoch();
+    node->count = 0;
+    node->is_leaf = is_leaf;
+    return node;
+}
+
+// Return the node to change in place of the given one: the node itself
+// if it was made in the current epoch, otherwise a copy of it, with the
+// original retired.
+template <typename N>
+N* writable(N* node)
+{
+    uint64_t epoch = get_epoch();
+    if (node->epoch == epoch)
+        return node;
+    N* copy = new N(*node);
+    copy->epoch = epoch;
+    retire(node);
+    return copy;
+}
+
+void retire_node(Node* node)
+{
+    if (node->is_leaf) {
+        retire(static_cast<Leaf*>(node));
+        return;
+    }
+    Inner* inner = static_cast<Inner*>(node);
+    for (int i = 0; i < inner->count; ++i)
+        retire_node(inner->children[i]);
+    retire(inner);
+}
+
+// Return the place of the child of the inner node whose range holds the title
+int child_place(const Inner* inner, uint64_t prefix, string_view title)
+{
+    int place = lower_place(inner, prefix, title, [inner](int place) { return inner->first_titles[place]; });
+    if (place < inner->count && inner->prefixes[place] == prefix && inner->first_titles[place] == title)
+        return place;
+    return max(place - 1, 0);
+}
+
+// Put the child at the place of the inner node, along with its first title
+void set_child(Inner* inner, int place, Node* child)
+{
+    inner->children[place] = child;
+    inner->first_titles[place] = first_title(child);
+    inner->prefixes[place] = child->prefixes[0];
+}
+
+// Add the child to the inner node at the place, splitting the node if it
+// is full. Return the new right half of a split, or nullptr.
+Inner* add_child(Inner* inner, int place, Node* child)
+{
+    if (inner->count < node_capacity) {
+        insert_at(inner->prefixes, inner->count, place, child->prefixes[0]);
+        insert_at(inner->first_titles, inner->count, place, first_title(child));
+        insert_at(inner->children, inner->count, place, child);
+        ++inner->count;
+        return nullptr;
+    }
+
+    Inner* right = make_node<Inner>(false);
+    int half = node_capacity / 2;
+    copy(inner->prefixes + half, inner->prefixes + node_capacity, right->prefixes);
+    copy(inner->first_titles + half, inner->first_titles + node_capacity, right->first_titles);
+    copy(inner->children + half, inner->children + node_capacity, right->children);
+    inner->count = half;
+    right->count = node_capacity - half;
+    if (place <= half)
+        add_child(inner, place, child);
+    else
+        add_child(right, place - half, child);
+    return right;
+}
+
+// Return the node to use in place of the given one with the entry added.
+// If the node had to be split, the new right half is put in split_off.
+Node* insert_into(Node* node, const Record_entry& entry, uint64_t prefix, Node*& split_off)
+{
+    split_off = nullptr;
+    if (node->is_leaf) {
+        Leaf* leaf = writable(static_cast<Leaf*>(node));
+        int place = entry_place(leaf, prefix, entry.title);
+        Leaf* target = leaf;
+        if (leaf->count == node_capacity) {
+            Leaf* right = make_node<Leaf>(true);
+            int half = node_capacity / 2;
+            copy(leaf->prefixes + half, leaf->prefixes + node_capacity, right->prefixes);
+            copy(leaf->entries + half, leaf->entries + node_capacity, right->entries);
+            leaf->count = half;
+            right->count = node_capacity - half;
+            if (place > half) {
+                target = right;
+                place -= half;
+            }
+            split_off = right;
+        }
+        insert_at(target->prefixes, target->count, place, prefix);
+        insert_at(target->entries, target->count, place, entry);
+        ++target->count;
+        return leaf;
+    }
+
+    Inner* inner = writable(static_cast<Inner*>(node));
+    int place = child_place(inner, prefix, entry.title);
+    Node* child_split;
+    set_child(inner, place, insert_into(inner->children[place], entry, prefix, child_split));
+    if (child_split)
+        split_off = add_child(inner, place + 1, child_split);
+    return inner;
+}
+
+// Return the node to use in place of the given one with the entry that
+// has the title removed, or nullptr if the node is left empty. found is
+// set to whether there was such an entry; if not, nothing is changed.
+Node* erase_from(Node* node, uint64_t prefix, string_view title, bool& found)
+{
+    if (node->is_leaf) {
+        Leaf* leaf = static_cast<Leaf*>(node);
+        int place = entry_place(leaf, prefix, title);
+        found = place < leaf->count && leaf->entries[place].title == title;
+        if (!found)
+            return leaf;
+
+        leaf = writable(leaf);
+        erase_at(leaf->prefixes, leaf->count, place);
+        erase_at(leaf->entries, leaf->count, place);
+        if (--leaf->count > 0)
+            return leaf;
+        retire(leaf);
+        return nullptr;
+    }
+
+    Inner* inner = static_cast<Inner*>(node);
+    int place = child_place(inner, prefix, title);
+    Node* child = erase_from(inner->children[place], prefix, title, found);
+    if (!found)
+        return inner;
+
+    inner = writable(inner);
+    if (child) {
+        set_child(inner, place, child);
+        return inner;
+    }
+    erase_at(inner->prefixes, inner->count, place);
+    erase_at(inner->first_titles, inner->count, place);
+    erase_at(inner->children, inner->count, place);
+    if (--inner->count > 0)
+        return inner;
+    retire(inner);
+    return nullptr;
+}
+
+}  // namespace
+
+// Print the entry in the same form as its Record
+ostream& operator<<(ostream& os, const Record_entry& entry)
+{
+    os << entry.id << ": " << *entry.medium << " ";
+
+    if (entry.rating == 0)
+        os << "u ";
+    else
+        os << entry.rating << " ";
+
+    os << entry.title << '\n';
+    return os;
+}
+
+// Move to the first entry of the leftmost leaf under the node
+void Entry_tree::const_iterator::descend(const Node* node)
+{
+    while (!node->is_leaf) {
+        const Inner* inner = static_cast<const Inner*>(node);
+        path.emplace_back(inner, 0);
+        node = inner->children[0];
+    }
+    const Leaf* leaf = static_cast<const Leaf*>(node);
+    pos = leaf->entries;
+    leaf_end = leaf->entries + leaf->count;
+}
+
+// Move to the first entry of the next leaf, or to the end
+void Entry_tree::const_iterator::next_leaf()
+{
+    while (!path.empty()) {
+        auto& [inner, place] = path.back();
+        if (++place < inner->count) {
+            descend(inner->children[place]);
+            return;
+        }
+        path.pop_back();
+    }
+    pos = nullptr;
+    leaf_end = nullptr;
+}
+
+// Add the entry, whose title must not be in the tree
+void Entry_tree::insert(const Record_entry& entry)
+{
+    ++num_entries;
+    uint64_t prefix = title_prefix(entry.title);
+    if (!root) {
+        Leaf* leaf = make_node<Leaf>(true);
+        leaf->prefixes[0] = prefix;
+        leaf->entries[0] = entry;
+        leaf->count = 1;
+        root = leaf;
+        return;
+    }
+
+    Node* split_off;
+    root = insert_into(root, entry, prefix, split_off);
+    if (split_off) {
+        Inner* new_root = make_node<Inner>(false);
+        add_child(new_root, 0, root);
+        add_child(new_root, 1, split_off);
+        root = new_root;
+    }
+}
+
+// Remove the entry with the title, if there is one
+void Entry_tree::erase(string_view title)
+{
+    if (!root)
+        return;
+
+    bool found;
+    root = erase_from(root, title_prefix(title), title, found);
+    if (!found)
+        return;
+    --num_entries;
+
+    // A root with one child is replaced by the child
+    while (root && !root->is_leaf && root->count == 1) {
+        Inner* old_root = static_cast<Inner*>(root);
+        root = old_root->children[0];
+        retire(old_root);
+    }
+}
+
+// Replace the contents with the entries, which are in title order. The
+// nodes are filled part way, leaving room for later inserts.
+void Entry_tree::assign(const vector<Record_entry>& sorted)
+{
+    clear();
+    if (sorted.empty())
+        return;
+
+    vector<Node*> level;
+    for (size_t i = 0; i < sorted.size(); i += build_fill) {
+        Leaf* leaf = make_node<Leaf>(true);
+        size_t end = min(sorted.size(), i + build_fill);
+        copy(sorted.begin() + i, sorted.begin() + end, leaf->entries);
+        leaf->count = int(end - i);
+        for (int place = 0; place < leaf->count; ++place)
+            leaf->prefixes[place] = title_prefix(leaf->entries[place].title);
+        level.push_back(leaf);
+    }
+
+    while (level.size() > 1) {
+        vector<Node*> parents;
+        for (size_t i = 0; i < level.size(); i += build_fill) {
+            Inner* inner = make_node<Inner>(false);
+            size_t end = min(level.size(), i + build_fill);
+            for (size_t j = i; j < end; ++j)
+                add_child(inner, inner->count, level[j]);
+            parents.push_back(inner);
+        }
+        level.swap(parents);
+    }
+
+    root = level.front();
+    num_entries = sorted.size();
+}
+
+// Remove all of the entries, retiring every node
+void Entry_tree::clear()
+{
+    if (root)
+        retire_node(root);
+    root = nullptr;
+    num_entries = 0;
+}
+
+Entry_tree::const_iterator Entry_tree::begin() const
+{
+    const_iterator it;
+    if (root)
+        it.descend(root);
+    return it;
+}
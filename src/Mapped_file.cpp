@@ -0,0 +1,38 @@
+#include "Mapped_file.h"
+#include "Utility.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Throw an Error if the file cannot be opened or mapped, or is empty
+Mapped_file::Mapped_file(const string& file_name)
+    : data(nullptr)
+    , size(0)
+{
+    int fd = open(file_name.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw Error("Could not open file!");
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) < 0 || file_stat.st_size == 0) {
+        close(fd);
+        throw Error("Invalid data found in file!");
+    }
+
+    size = file_stat.st_size;
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED)
+        throw Error("Could not open file!");
+
+    data = static_cast<const char*>(mapped);
+    madvise(mapped, size, MADV_SEQUENTIAL);
+}
+
+Mapped_file::~Mapped_file()
+{
+    munmap(const_cast<char*>(data), size);
+}
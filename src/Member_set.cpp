@@ -0,0 +1,357 @@
+#include "Member_set.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+// A set grows past this many IDs before it is split into chunks, and
+// goes back to a plain vector once it shrinks below half of it.
+const int max_small_size = 4096;
+
+// A chunk's array becomes a bitmap past this many values, where the
+// 8 KiB bitmap is no bigger than the array, and goes back to an array
+// below half of it.
+const int max_array_size = 4096;
+
+const size_t bitmap_words = (1 << 16) / 64;
+
+}  // namespace
+
+// Add the ID. Return false if it was already present.
+bool Member_set::insert(uint32_t id)
+{
+    if (!compressed) {
+        auto iter = lower_bound(ids.begin(), ids.end(), id);
+        if (iter != ids.end() && *iter == id)
+            return false;
+        ids.insert(iter, id);
+        if (++count > max_small_size)
+            compress();
+        return true;
+    }
+
+    uint32_t key = id >> 16;
+    auto chunk_iter = find_chunk(key);
+    if (chunk_iter == chunks.end() || chunk_iter->key != key)
+        chunk_iter = chunks.emplace(chunk_iter, key);
+    if (!chunk_iter->insert(id & 0xffff))
+        return false;
+    ++count;
+    return true;
+}
+
+// Remove the ID. Return false if it was not present.
+bool Member_set::erase(uint32_t id)
+{
+    if (!compressed) {
+        auto iter = lower_bound(ids.begin(), ids.end(), id);
+        if (iter == ids.end() || *iter != id)
+            return false;
+        ids.erase(iter);
+        --count;
+        return true;
+    }
+
+    uint32_t key = id >> 16;
+    auto chunk_iter = find_chunk(key);
+    if (chunk_iter == chunks.end() || chunk_iter->key != key || !chunk_iter->erase(id & 0xffff))
+        return false;
+    if (chunk_iter->count == 0)
+        chunks.erase(chunk_iter);
+    if (--count < max_small_size / 2)
+        decompress();
+    return true;
+}
+
+// Return true if the ID is present.
+bool Member_set::contains(uint32_t id) const
+{
+    if (!compressed)
+        return binary_search(ids.begin(), ids.end(), id);
+
+    uint32_t key = id >> 16;
+    auto chunk_iter = find_chunk(key);
+    return chunk_iter != chunks.end() && chunk_iter->key == key && chunk_iter->contains(id & 0xffff);
+}
+
+// Remove every ID and return to the small representation.
+void Member_set::clear()
+{
+    Member_vector<uint32_t>().swap(ids);
+    Member_vector<Chunk>().swap(chunks);
+    count = 0;
+    compressed = false;
+}
+
+// Return the IDs in either set, in both sets, or in the first set
+// but not the second.
+Member_set Member_set::set_union(const Member_set& s1, const Member_set& s2)
+{
+    return combine(s1, s2, Operation::set_union);
+}
+
+Member_set Member_set::set_intersection(const Member_set& s1, const Member_set& s2)
+{
+    return combine(s1, s2, Operation::set_intersection);
+}
+
+Member_set Member_set::set_difference(const Member_set& s1, const Member_set& s2)
+{
+    return combine(s1, s2, Operation::set_difference);
+}
+
+// Move the sorted IDs into chunks
+void Member_set::compress()
+{
+    split_into_chunks().swap(chunks);
+    Member_vector<uint32_t>().swap(ids);
+    compressed = true;
+}
+
+// Move the chunks' IDs back into a sorted vector
+void Member_set::decompress()
+{
+    ids.reserve(count);
+    for_each([&](uint32_t id) { ids.push_back(id); });
+    Member_vector<Chunk>().swap(chunks);
+    compressed = false;
+}
+
+// Return the sorted IDs of a small set split into chunks
+Member_set::Member_vector<Member_set::Chunk> Member_set::split_into_chunks() const
+{
+    Member_vector<Chunk> result;
+    for (uint32_t id : ids) {
+        uint32_t key = id >> 16;
+        if (result.empty() || result.back().key != key)
+            result.emplace_back(key);
+        result.back().array.push_back(id & 0xffff);
+    }
+    for (Chunk& chunk : result)
+        chunk.normalize();
+    return result;
+}
+
+// Combine two sets with the operation. Small sets are merged as sorted
+// vectors; otherwise the chunks with the same high bits are combined,
+// and a chunk present in only one set is kept if the operation says so.
+Member_set Member_set::combine(const Member_set& s1, const Member_set& s2, Operation operation)
+{
+    Member_set result;
+
+    if (!s1.compressed && !s2.compressed) {
+        // Room for the largest possible result, so the vector is not
+        // reallocated as it fills
+        if (operation == Operation::set_union)
+            result.ids.reserve(s1.ids.size() + s2.ids.size());
+        else if (operation == Operation::set_intersection)
+            result.ids.reserve(std::min(s1.ids.size(), s2.ids.size()));
+        else
+            result.ids.reserve(s1.ids.size());
+        auto out_it = back_inserter(result.ids);
+        switch (operation) {
+        case Operation::set_union:
+            std::set_union(s1.ids.begin(), s1.ids.end(), s2.ids.begin(), s2.ids.end(), out_it);
+            break;
+        case Operation::set_intersection:
+            std::set_intersection(s1.ids.begin(), s1.ids.end(), s2.ids.begin(), s2.ids.end(), out_it);
+            break;
+        case Operation::set_difference:
+            std::set_difference(s1.ids.begin(), s1.ids.end(), s2.ids.begin(), s2.ids.end(), out_it);
+            break;
+        }
+        result.count = result.ids.size();
+        if (result.count > max_small_size)
+            result.compress();
+        return result;
+    }
+
+    // A small set is split into chunks so that both sides match
+    Member_vector<Chunk> split1, split2;
+    if (!s1.compressed)
+        split1 = s1.split_into_chunks();
+    if (!s2.compressed)
+        split2 = s2.split_into_chunks();
+    const Member_vector<Chunk>& chunks1 = s1.compressed ? s1.chunks : split1;
+    const Member_vector<Chunk>& chunks2 = s2.compressed ? s2.chunks : split2;
+
+    bool keep_first_only = operation != Operation::set_intersection;
+    bool keep_second_only = operation == Operation::set_union;
+    auto it1 = chunks1.begin(), it2 = chunks2.begin();
+    while (it1 != chunks1.end() || it2 != chunks2.end()) {
+        if (it2 == chunks2.end() || (it1 != chunks1.end() && it1->key < it2->key)) {
+            if (keep_first_only)
+                result.chunks.push_back(*it1);
+            ++it1;
+        } else if (it1 == chunks1.end() || it2->key < it1->key) {
+            if (keep_second_only)
+                result.chunks.push_back(*it2);
+            ++it2;
+        } else {
+            Chunk chunk = combine_chunks(*it1, *it2, operation);
+            if (chunk.count > 0)
+                result.chunks.push_back(move(chunk));
+            ++it1;
+            ++it2;
+        }
+    }
+
+    result.compressed = true;
+    for (const Chunk& chunk : result.chunks)
+        result.count += chunk.count;
+    if (result.count < max_small_size / 2)
+        result.decompress();
+    return result;
+}
+
+// Combine two chunks with the same high bits. Two arrays are merged;
+// otherwise the chunks are combined as bitmaps a word at a time.
+Member_set::Chunk Member_set::combine_chunks(const Chunk& c1, const Chunk& c2, Operation operation)
+{
+    Chunk result(c1.key);
+
+    if (c1.bitmap.empty() && c2.bitmap.empty()) {
+        auto out_it = back_inserter(result.array);
+        switch (operation) {
+        case Operation::set_union:
+            std::set_union(c1.array.begin(), c1.array.end(), c2.array.begin(), c2.array.end(), out_it);
+            break;
+        case Operation::set_intersection:
+            std::set_intersection(c1.array.begin(), c1.array.end(), c2.array.begin(), c2.array.end(), out_it);
+            break;
+        case Operation::set_difference:
+            std::set_difference(c1.array.begin(), c1.array.end(), c2.array.begin(), c2.array.end(), out_it);
+            break;
+        }
+        result.normalize();
+        return result;
+    }
+
+    // Work on bitmaps, converting an array side into a temporary bitmap
+    Chunk temp1(c1.key), temp2(c2.key);
+    if (c1.bitmap.empty()) {
+        temp1.array = c1.array;
+        temp1.to_bitmap();
+    }
+    if (c2.bitmap.empty()) {
+        temp2.array = c2.array;
+        temp2.to_bitmap();
+    }
+    const Member_vector<uint64_t>& bits1 = c1.bitmap.empty() ? temp1.bitmap : c1.bitmap;
+    const Member_vector<uint64_t>& bits2 = c2.bitmap.empty() ? temp2.bitmap : c2.bitmap;
+
+    result.bitmap.resize(bitmap_words);
+    for (size_t word = 0; word < bitmap_words; ++word) {
+        switch (operation) {
+        case Operation::set_union:
+            result.bitmap[word] = bits1[word] | bits2[word];
+            break;
+        case Operation::set_intersection:
+            result.bitmap[word] = bits1[word] & bits2[word];
+            break;
+        case Operation::set_difference:
+            result.bitmap[word] = bits1[word] & ~bits2[word];
+            break;
+        }
+    }
+    result.normalize();
+    return result;
+}
+
+// Return the chunk for the high bits, or the place to insert it
+Member_set::Member_vector<Member_set::Chunk>::iterator Member_set::find_chunk(uint32_t key)
+{
+    return lower_bound(
+        chunks.begin(), chunks.end(), key, [](const Chunk& chunk, uint32_t key_) { return chunk.key < key_; });
+}
+
+Member_set::Member_vector<Member_set::Chunk>::const_iterator Member_set::find_chunk(uint32_t key) const
+{
+    return lower_bound(
+        chunks.begin(), chunks.end(), key, [](const Chunk& chunk, uint32_t key_) { return chunk.key < key_; });
+}
+
+bool Member_set::Chunk::insert(uint16_t low)
+{
+    if (!bitmap.empty()) {
+        uint64_t bit = uint64_t(1) << (low % 64);
+        if (bitmap[low / 64] & bit)
+            return false;
+        bitmap[low / 64] |= bit;
+        ++count;
+        return true;
+    }
+
+    auto iter = lower_bound(array.begin(), array.end(), low);
+    if (iter != array.end() && *iter == low)
+        return false;
+    array.insert(iter, low);
+    if (++count > max_array_size)
+        to_bitmap();
+    return true;
+}
+
+bool Member_set::Chunk::erase(uint16_t low)
+{
+    if (!bitmap.empty()) {
+        uint64_t bit = uint64_t(1) << (low % 64);
+        if (!(bitmap[low / 64] & bit))
+            return false;
+        bitmap[low / 64] &= ~bit;
+        if (--count < max_array_size / 2)
+            to_array();
+        return true;
+    }
+
+    auto iter = lower_bound(array.begin(), array.end(), low);
+    if (iter == array.end() || *iter != low)
+        return false;
+    array.erase(iter);
+    --count;
+    return true;
+}
+
+bool Member_set::Chunk::contains(uint16_t low) const
+{
+    if (!bitmap.empty())
+        return bitmap[low / 64] & (uint64_t(1) << (low % 64));
+    return binary_search(array.begin(), array.end(), low);
+}
+
+// Switch between the array and the bitmap as the chunk fills or empties
+void Member_set::Chunk::to_bitmap()
+{
+    bitmap.assign(bitmap_words, 0);
+    for (uint16_t low : array)
+        bitmap[low / 64] |= uint64_t(1) << (low % 64);
+    Member_vector<uint16_t>().swap(array);
+}
+
+void Member_set::Chunk::to_array()
+{
+    array.reserve(count);
+    for (size_t word = 0; word < bitmap.size(); ++word) {
+        for (uint64_t bits = bitmap[word]; bits != 0; bits &= bits - 1)
+            array.push_back(word * 64 + __builtin_ctzll(bits));
+    }
+    Member_vector<uint64_t>().swap(bitmap);
+}
+
+// Recount a combined chunk and give it the representation that
+// suits its new count
+void Member_set::Chunk::normalize()
+{
+    if (bitmap.empty()) {
+        count = array.size();
+        if (count > max_array_size)
+            to_bitmap();
+        return;
+    }
+
+    count = 0;
+    for (uint64_t bits : bitmap)
+        count += __builtin_popcountll(bits);
+    if (count < max_array_size / 2)
+        to_array();
+}
@@ -0,0 +1,108 @@
+#include "Memory_usage.h"
+#include <atomic>
+
+using namespace std;
+
+namespace {
+
+const char* const category_names[num_memory_categories] = {
+    "Records",
+    "Titles and media",
+    "Freed titles",
+    "Record arena free space",
+    "Title index",
+    "ID index",
+    "Search index",
+    "Published versions",
+    "Collection members",
+    "Catalog"};
+
+atomic<size_t> in_use[num_memory_categories];
+atomic<size_t> total_in_use(0);
+
+bool peaks_tracked = false;
+atomic<size_t> peaks[num_memory_categories];
+atomic<size_t> total_peak(0);
+
+// Raise the peak to the value if it is lower
+void raise_peak(atomic<size_t>& peak, size_t value)
+{
+    size_t highest = peak.load(memory_order_relaxed);
+    while (value > highest && !peak.compare_exchange_weak(highest, value, memory_order_relaxed)) {
+    }
+}
+
+}  // namespace
+
+// Return the name of the category for printing
+const char* memory_category_name(Memory_category category)
+{
+    return category_names[static_cast<int>(category)];
+}
+
+// Count bytes allocated for the category
+void count_allocation(Memory_category category, size_t bytes)
+{
+    int index = static_cast<int>(category);
+    size_t category_bytes = in_use[index].fetch_add(bytes, memory_order_relaxed) + bytes;
+    size_t total_bytes = total_in_use.fetch_add(bytes, memory_order_relaxed) + bytes;
+    if (peaks_tracked) {
+        raise_peak(peaks[index], category_bytes);
+        raise_peak(total_peak, total_bytes);
+    }
+}
+
+// Count bytes freed from the category
+void count_deallocation(Memory_category category, size_t bytes)
+{
+    in_use[static_cast<int>(category)].fetch_sub(bytes, memory_order_relaxed);
+    total_in_use.fetch_sub(bytes, memory_order_relaxed);
+}
+
+// Move bytes from one category to another; the total does not change
+void count_transfer(Memory_category from, Memory_category to, size_t bytes)
+{
+    in_use[static_cast<int>(from)].fetch_sub(bytes, memory_order_relaxed);
+    size_t category_bytes = in_use[static_cast<int>(to)].fetch_add(bytes, memory_order_relaxed) + bytes;
+    if (peaks_tracked)
+        raise_peak(peaks[static_cast<int>(to)], category_bytes);
+}
+
+// Return the bytes in use now, in the category or in total
+size_t memory_in_use(Memory_category category)
+{
+    return in_use[static_cast<int>(category)].load(memory_order_relaxed);
+}
+
+size_t total_memory_in_use()
+{
+    return total_in_use.load(memory_order_relaxed);
+}
+
+// Keep the most bytes ever in use from now on, starting from what is in
+// use already
+void track_memory_peaks()
+{
+    for (int index = 0; index < num_memory_categories; ++index)
+        peaks[index] = in_use[index].load();
+    total_peak = total_in_use.load();
+    peaks_tracked = true;
+}
+
+// Return true if the peaks are being kept
+bool memory_peaks_tracked()
+{
+    return peaks_tracked;
+}
+
+// Return the most bytes that were in use since tracking started, in the
+// category or in total
+size_t memory_peak(Memory_category category)
+{
+    return peaks[static_cast<int>(category)].load(memory_order_relaxed);
+}
+
+size_t total_memory_peak()
+{
+    return total_peak.load(memory_order_relaxed);
+}
@@ -0,0 +1,94 @@
+#include "Output_buffer.h"
+#include "Utility.h"
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+// Pending output is written once it grows past this size
+const size_t buffer_size = 1 << 16;
+
+}  // namespace
+
+// Install the buffer under the stream
+Output_buffer::Output_buffer(ostream& os_, Flush_policy policy_)
+    : os(os_)
+    , original(os_.rdbuf())
+    , policy(policy_)
+{
+    pending.reserve(buffer_size);
+    os.rdbuf(this);
+}
+
+// Flush the pending output and give the stream back its own buffer
+Output_buffer::~Output_buffer()
+{
+    write_pending();
+    os.rdbuf(original);
+}
+
+// Called at the end of each command; writes the pending output
+// unless the policy is full.
+void Output_buffer::end_command()
+{
+    if (policy != Flush_policy::full)
+        write_pending();
+}
+
+Output_buffer::int_type Output_buffer::overflow(int_type ch)
+{
+    if (traits_type::eq_int_type(ch, traits_type::eof()))
+        return traits_type::not_eof(ch);
+
+    char c = traits_type::to_char_type(ch);
+    pending.push_back(c);
+    check_flush(c == '\n');
+    return ch;
+}
+
+streamsize Output_buffer::xsputn(const char* s, streamsize n)
+{
+    pending.insert(pending.end(), s, s + n);
+    check_flush(policy == Flush_policy::line && memchr(s, '\n', n) != nullptr);
+    return n;
+}
+
+int Output_buffer::sync()
+{
+    return write_pending() ? 0 : -1;
+}
+
+// Write the pending output if the buffer is full or the policy
+// asks for it at a newline.
+void Output_buffer::check_flush(bool newline)
+{
+    if (pending.size() >= buffer_size || (newline && policy == Flush_policy::line))
+        write_pending();
+}
+
+// Write the pending output to the original buffer and flush it.
+// Return false if it could not be written.
+bool Output_buffer::write_pending()
+{
+    if (pending.empty())
+        return true;
+
+    streamsize size = pending.size();
+    bool written = original->sputn(pending.data(), size) == size;
+    pending.clear();
+    return original->pubsync() == 0 && written;
+}
+
+// Return the flush policy named by the string, or throw an Error if
+// there is no policy with that name.
+Flush_policy flush_policy_from_name(const char* name)
+{
+    if (strcmp(name, "line") == 0)
+        return Flush_policy::line;
+    if (strcmp(name, "command") == 0)
+        return Flush_policy::command;
+    if (strcmp(name, "full") == 0)
+        return Flush_policy::full;
+    throw Error("Unknown flush policy!");
+}
@@ -0,0 +1,253 @@
+#include "Parallel.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+// The tasks of one call to parallel_invoke, and the errors they threw
+struct Task_group
+{
+    explicit Task_group(size_t num_tasks)
+        : num_left(num_tasks)
+        , errors(num_tasks)
+    { }
+
+    atomic<size_t> num_left;
+    vector<exception_ptr> errors;
+    mutex done_mutex;
+    condition_variable done;
+};
+
+struct Task
+{
+    const function<void()>* func;
+    Task_group* group;
+    size_t index;
+};
+
+struct Task_queue
+{
+    mutex queue_mutex;
+    deque<Task> tasks;
+};
+
+class Thread_pool
+{
+public:
+    // Start the worker threads, each with a queue of its own. With no
+    // workers, the one queue is emptied by the threads that wait.
+    explicit Thread_pool(size_t num_workers);
+
+    // Stop the workers, which are idle by then
+    ~Thread_pool();
+
+    // Queue the task: on a pool thread's own queue, or else on the
+    // queues in turn.
+    void submit(const Task& task);
+
+    // Run a queued task, from the thread's own queue if it has one or
+    // stolen from another. Return false if there was none.
+    bool run_one();
+
+private:
+    // Run tasks until the pool is stopped, sleeping while there are none
+    void work(size_t index);
+
+    // Take a task from the back of the thread's own queue, or from the
+    // front of another. Return false if every queue is empty.
+    bool take(Task& task);
+
+    vector<unique_ptr<Task_queue>> queues;
+    vector<thread> workers;
+    atomic<size_t> next_queue;
+
+    // Idle workers sleep until a task is queued or the pool stops
+    mutex sleep_mutex;
+    condition_variable wake;
+    atomic<size_t> num_queued;
+    bool stopping;
+};
+
+// The queue of the pool thread running, or -1 on other threads
+thread_local int own_queue = -1;
+
+// The number set by set_parallel_threads, or 0 if it was not called
+atomic<size_t> num_parallel_threads(0);
+
+// Run the task, keeping what it throws, and count it as done
+void run(const Task& task)
+{
+    Task_group& group = *task.group;
+    try {
+        (*task.func)();
+    } catch (...) {
+        group.errors[task.index] = current_exception();
+    }
+
+    // The waiting thread may end the group as soon as the count is zero,
+    // so the count only changes under the lock it waits with
+    lock_guard<mutex> lock(group.done_mutex);
+    if (--group.num_left == 0)
+        group.done.notify_all();
+}
+
+Thread_pool::Thread_pool(size_t num_workers)
+    : next_queue(0)
+    , num_queued(0)
+    , stopping(false)
+{
+    for (size_t i = 0; i < max<size_t>(1, num_workers); ++i)
+        queues.push_back(make_unique<Task_queue>());
+    for (size_t i = 0; i < num_workers; ++i)
+        workers.emplace_back(&Thread_pool::work, this, i);
+}
+
+Thread_pool::~Thread_pool()
+{
+    {
+        lock_guard<mutex> lock(sleep_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (thread& worker : workers)
+        worker.join();
+}
+
+// Queue the task: on a pool thread's own queue, or else on the queues
+// in turn.
+void Thread_pool::submit(const Task& task)
+{
+    size_t index = own_queue >= 0 ? size_t(own_queue) : next_queue++ % queues.size();
+    {
+        lock_guard<mutex> lock(queues[index]->queue_mutex);
+        queues[index]->tasks.push_back(task);
+    }
+    {
+        lock_guard<mutex> lock(sleep_mutex);
+        ++num_queued;
+    }
+    wake.notify_one();
+}
+
+// Run a queued task, from the thread's own queue if it has one or stolen
+// from another. Return false if there was none.
+bool Thread_pool::run_one()
+{
+    Task task;
+    if (!take(task))
+        return false;
+    run(task);
+    return true;
+}
+
+// Run tasks until the pool is stopped, sleeping while there are none
+void Thread_pool::work(size_t index)
+{
+    own_queue = int(index);
+    while (true) {
+        if (run_one())
+            continue;
+
+        unique_lock<mutex> lock(sleep_mutex);
+        wake.wait(lock, [this] { return stopping || num_queued > 0; });
+        if (stopping)
+            return;
+    }
+}
+
+// Take a task from the back of the thread's own queue, where the tasks
+// it queued last are still warm in its cache, or from the front of
+// another, where the oldest and usually biggest tasks are. Return false
+// if every queue is empty.
+bool Thread_pool::take(Task& task)
+{
+    size_t first = 0;
+    if (own_queue >= 0) {
+        Task_queue& queue = *queues[own_queue];
+        lock_guard<mutex> lock(queue.queue_mutex);
+        if (!queue.tasks.empty()) {
+            task = queue.tasks.back();
+            queue.tasks.pop_back();
+            --num_queued;
+            return true;
+        }
+        first = own_queue + 1;
+    }
+
+    for (size_t i = 0; i < queues.size(); ++i) {
+        Task_queue& queue = *queues[(first + i) % queues.size()];
+        lock_guard<mutex> lock(queue.queue_mutex);
+        if (!queue.tasks.empty()) {
+            task = queue.tasks.front();
+            queue.tasks.pop_front();
+            --num_queued;
+            return true;
+        }
+    }
+    return false;
+}
+
+// The pool is started on first use, with one thread fewer than the
+// parallel threads since the waiting thread works too
+Thread_pool& pool()
+{
+    static Thread_pool thread_pool(parallel_threads() - 1);
+    return thread_pool;
+}
+
+}  // namespace
+
+// Run each task on the pool and wait for all of them. The calling thread
+// runs the first task, then other queued tasks until none are left, and
+// then waits for those still running elsewhere. With a single thread the
+// caller runs them all, one after another.
+void parallel_invoke(const vector<function<void()>>& tasks)
+{
+    if (tasks.empty())
+        return;
+
+    Task_group group(tasks.size());
+    for (size_t i = 1; i < tasks.size(); ++i)
+        pool().submit(Task{&tasks[i], &group, i});
+
+    run(Task{&tasks[0], &group, 0});
+    while (group.num_left > 0 && pool().run_one()) {
+    }
+    {
+        unique_lock<mutex> lock(group.done_mutex);
+        group.done.wait(lock, [&group] { return group.num_left == 0; });
+    }
+
+    for (const exception_ptr& error : group.errors) {
+        if (error)
+            rethrow_exception(error);
+    }
+}
+
+// Return the number of threads the hardware runs at once.
+size_t hardware_threads()
+{
+    static const size_t num_threads = max(1u, thread::hardware_concurrency());
+    return num_threads;
+}
+
+// Set the number of threads parallel work runs on, counting the thread
+// that waits for it. Must be called before any parallel work is done.
+void set_parallel_threads(size_t num_threads)
+{
+    num_parallel_threads = max<size_t>(1, num_threads);
+}
+
+// Return the number of threads parallel work runs on.
+size_t parallel_threads()
+{
+    size_t num_threads = num_parallel_threads;
+    return num_threads > 0 ? num_threads : hardware_threads();
+}
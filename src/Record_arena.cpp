@@ -0,0 +1,273 @@
+#include "Record_arena.h"
+#include "Epoch.h"
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+using namespace std;
+
+// Releasing the arena never runs Record destructors
+static_assert(is_trivially_destructible<Record>::value, "Records must not own heap data");
+static_assert(sizeof(Record) >= sizeof(void*), "a deleted Record must hold a free list link");
+
+namespace {
+
+// Blocks start small so that an empty library stays small, and double
+// up to the maximum as the library grows.
+const size_t min_block_size = 4096;
+const size_t max_block_size = 1 << 20;
+
+// Slots up to this size are multiples of slot_step; above it there are
+// four slot sizes to each power of two
+const size_t small_slot_limit = 256;
+const size_t slot_step = 8;
+const int num_small_classes = small_slot_limit / slot_step;
+
+// Return the class of the smallest slot that holds a string of the size
+int class_of(size_t size)
+{
+    if (size <= small_slot_limit)
+        return static_cast<int>((size + slot_step - 1) / slot_step) - 1;
+
+    // 2^(exponent - 1) < size <= 2^exponent, in quarters of the lower half
+    int exponent = 64 - __builtin_clzll(size - 1);
+    size_t quarter = size_t(1) << (exponent - 3);
+    int quarters = static_cast<int>((size - (size_t(1) << (exponent - 1)) + quarter - 1) / quarter);
+    return num_small_classes + (exponent - 9) * 4 + quarters - 1;
+}
+
+// Return the size of the slots of the class
+size_t slot_size(int slot_class)
+{
+    if (slot_class < num_small_classes)
+        return (slot_class + 1) * slot_step;
+
+    int exponent = (slot_class - num_small_classes) / 4 + 9;
+    int quarters = (slot_class - num_small_classes) % 4 + 1;
+    return (size_t(1) << (exponent - 1)) + quarters * (size_t(1) << (exponent - 3));
+}
+
+// Return the bytes the string holds on the heap, which are none if it is
+// short enough to be kept inside the string object
+size_t heap_bytes(const string& str)
+{
+    const char* data = str.data();
+    const char* object = reinterpret_cast<const char*>(&str);
+    if (data >= object && data < object + sizeof(str))
+        return 0;
+    return str.capacity() + 1;
+}
+
+}  // namespace
+
+// A moved-from arena is left empty
+Record_arena::Record_arena(Record_arena&& other)
+    : Record_arena()
+{
+    swap(other);
+}
+
+Record_arena::~Record_arena()
+{
+    release();
+}
+
+Record_arena& Record_arena::operator=(Record_arena&& other)
+{
+    release();
+    swap(other);
+    return *this;
+}
+
+// Create a Record in the arena, with a copy of the title also stored
+// in the arena and the medium interned.
+Record* Record_arena::create(int id, string_view medium, string_view title, int rating)
+{
+    const string& stored_medium = intern_medium(medium);
+    string_view stored_title = store_string(title);
+
+    void* memory;
+    if (free_records != nullptr) {
+        memory = free_records;
+        free_records = free_records->next;
+        record_bytes += sizeof(Record);
+        count_transfer(Memory_category::arena_free, Memory_category::records, sizeof(Record));
+    } else
+        memory = allocate(sizeof(Record), alignof(Record), Memory_category::records);
+
+    return new (memory) Record(id, stored_medium, stored_title, rating);
+}
+
+// Return the shared copy of the medium, adding it if it is new.
+const string& Record_arena::intern_medium(string_view medium)
+{
+    auto it = medium_index.find(medium);
+    if (it != medium_index.end())
+        return *it->second;
+
+    media.emplace_back(medium);
+    medium_index.emplace(media.back(), &media.back());
+    count_allocation(Memory_category::strings, heap_bytes(media.back()));
+    return media.back();
+}
+
+// Copy the string into the arena and return a view of the copy, reusing
+// the slot of a freed string of the same slot size.
+string_view Record_arena::store_string(string_view str)
+{
+    if (str.empty())
+        return string_view();
+
+    int slot_class = class_of(str.size());
+    size_t size = slot_size(slot_class);
+    char* memory = free_strings ? free_strings->take(slot_class) : nullptr;
+    if (memory != nullptr) {
+        freed_bytes -= size;
+        string_bytes += size;
+        count_transfer(Memory_category::freed_strings, Memory_category::strings, size);
+    } else
+        memory = allocate(size, 1, Memory_category::strings);
+    memcpy(memory, str.data(), str.size());
+    return string_view(memory, str.size());
+}
+
+// Set the slot of a string stored in the arena aside for reuse once no
+// reader can see it.
+void Record_arena::free_string(string_view str)
+{
+    if (str.empty())
+        return;
+
+    int slot_class = class_of(str.size());
+    size_t size = slot_size(slot_class);
+    unretired_strings.push_back(Slot{const_cast<char*>(str.data()), slot_class});
+    string_bytes -= size;
+    freed_bytes += size;
+    unretired_bytes += size;
+    count_transfer(Memory_category::strings, Memory_category::freed_strings, size);
+}
+
+// Hand the strings freed since the last call over to the epoch, to be
+// reused once no reader can see them.
+void Record_arena::retire_freed_strings()
+{
+    if (unretired_strings.empty())
+        return;
+
+    if (!free_strings)
+        free_strings = allocate_shared<Free_strings>(Counting_allocator<Free_strings, Memory_category::strings>());
+    retire(new Freed_batch{free_strings, move(unretired_strings)}, return_freed);
+    unretired_strings = Slots_t();
+    unretired_bytes = 0;
+}
+
+// Give a retired batch's slots back to its arena, if it still has them
+void Record_arena::return_freed(void* batch_ptr)
+{
+    unique_ptr<Freed_batch> batch(static_cast<Freed_batch*>(batch_ptr));
+    shared_ptr<Free_strings> target = batch->target.lock();
+    if (!target)
+        return;
+    for (const Slot& slot : batch->slots)
+        target->add(slot);
+}
+
+void Record_arena::Free_strings::add(const Slot& slot)
+{
+    if (slot.slot_class >= static_cast<int>(classes.size()))
+        classes.resize(slot.slot_class + 1);
+    classes[slot.slot_class].push_back(slot.data);
+}
+
+// Return a freed slot of the class, or nullptr if there is none.
+char* Record_arena::Free_strings::take(int slot_class)
+{
+    if (slot_class >= static_cast<int>(classes.size()) || classes[slot_class].empty())
+        return nullptr;
+    char* data = classes[slot_class].back();
+    classes[slot_class].pop_back();
+    return data;
+}
+
+// Put the Record's memory on the free list for reuse.
+void Record_arena::destroy(Record* record_ptr)
+{
+    Free_record* freed = new (static_cast<void*>(record_ptr)) Free_record;
+    freed->next = free_records;
+    free_records = freed;
+    record_bytes -= sizeof(Record);
+    count_transfer(Memory_category::records, Memory_category::arena_free, sizeof(Record));
+}
+
+// Free all of the arena's memory in one step.
+void Record_arena::release()
+{
+    count_deallocation(Memory_category::records, record_bytes);
+    count_deallocation(Memory_category::strings, string_bytes);
+    count_deallocation(Memory_category::freed_strings, freed_bytes);
+    count_deallocation(Memory_category::arena_free, bytes_reserved - record_bytes - string_bytes - freed_bytes);
+    for (const string& medium : media)
+        count_deallocation(Memory_category::strings, heap_bytes(medium));
+
+    blocks.clear();
+    block_pos = nullptr;
+    block_left = 0;
+    free_records = nullptr;
+    free_strings.reset();
+    unretired_strings.clear();
+    medium_index.clear();
+    media.clear();
+    bytes_reserved = 0;
+    record_bytes = 0;
+    string_bytes = 0;
+    freed_bytes = 0;
+    unretired_bytes = 0;
+}
+
+void Record_arena::swap(Record_arena& other)
+{
+    blocks.swap(other.blocks);
+    std::swap(block_pos, other.block_pos);
+    std::swap(block_left, other.block_left);
+    std::swap(free_records, other.free_records);
+    free_strings.swap(other.free_strings);
+    unretired_strings.swap(other.unretired_strings);
+    media.swap(other.media);
+    medium_index.swap(other.medium_index);
+    std::swap(bytes_reserved, other.bytes_reserved);
+    std::swap(record_bytes, other.record_bytes);
+    std::swap(string_bytes, other.string_bytes);
+    std::swap(freed_bytes, other.freed_bytes);
+    std::swap(unretired_bytes, other.unretired_bytes);
+}
+
+// Return size bytes aligned to align for the category of memory, taking
+// a new block if the current one does not have room.
+char* Record_arena::allocate(size_t size, size_t align, Memory_category category)
+{
+    size_t padding = (align - reinterpret_cast<uintptr_t>(block_pos) % align) % align;
+    if (block_pos == nullptr || padding + size > block_left) {
+        size_t block_size = blocks.empty() ? min_block_size : min(bytes_reserved, max_block_size);
+        // A string too long for a normal block gets a block of its own
+        block_size = max(block_size, size + align);
+
+        blocks.emplace_back(new char[block_size]);
+        block_pos = blocks.back().get();
+        block_left = block_size;
+        bytes_reserved += block_size;
+        count_allocation(Memory_category::arena_free, block_size);
+        padding = (align - reinterpret_cast<uintptr_t>(block_pos) % align) % align;
+    }
+
+    char* memory = block_pos + padding;
+    block_pos += padding + size;
+    block_left -= padding + size;
+    if (category == Memory_category::records)
+        record_bytes += size;
+    else
+        string_bytes += size;
+    count_transfer(Memory_category::arena_free, category, size);
+    return memory;
+}
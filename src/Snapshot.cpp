@@ -0,0 +1,523 @@
+#include "Snapshot.h"
+#include "Catalog.h"
+#include "Collection.h"
+#include "Library.h"
+#include "Mapped_file.h"
+#include "Parallel.h"
+#include "Record.h"
+#include "Utility.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+const char snapshot_magic[8] = {'S', 'M', 'M', 'S', 'N', 'A', 'P', '\0'};
+const uint32_t snapshot_version = 1;
+
+const uint64_t fnv_offset_basis = 14695981039346656037ULL;
+const uint64_t fnv_prime = 1099511628211ULL;
+
+// Fold bytes into a running FNV-1a checksum
+uint64_t fnv1a(uint64_t hash, const char* data, size_t size)
+{
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= fnv_prime;
+    }
+    return hash;
+}
+
+// Writes the snapshot through a buffer and keeps the checksum of
+// everything written so far.
+class Snapshot_writer
+{
+public:
+    Snapshot_writer(ofstream& os_)
+        : os(os_)
+        , checksum(fnv_offset_basis)
+    { }
+
+    void write_bytes(const char* data, size_t size)
+    {
+        checksum = fnv1a(checksum, data, size);
+        buffer.append(data, size);
+        if (buffer.size() >= buffer_limit)
+            flush();
+    }
+    void write_u32(uint32_t value)
+    {
+        char bytes[4];
+        for (int i = 0; i < 4; ++i)
+            bytes[i] = static_cast<char>(value >> (8 * i));
+        write_bytes(bytes, 4);
+    }
+    void write_i32(int value)
+    {
+        write_u32(static_cast<uint32_t>(value));
+    }
+    void write_string(string_view str)
+    {
+        write_u32(str.size());
+        write_bytes(str.data(), str.size());
+    }
+    // Append the checksum itself, which is not part of the checksum,
+    // and return it
+    uint64_t write_checksum()
+    {
+        uint64_t value = checksum;
+        char bytes[8];
+        for (int i = 0; i < 8; ++i)
+            bytes[i] = static_cast<char>(value >> (8 * i));
+        buffer.append(bytes, 8);
+        flush();
+        return value;
+    }
+    void flush()
+    {
+        os.write(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+
+private:
+    static const size_t buffer_limit = 1 << 16;
+
+    ofstream& os;
+    string buffer;
+    uint64_t checksum;
+};
+
+// Reads fields from the mapped snapshot. Every read checks that the
+// field lies within the data and throws an Error if it does not.
+class Snapshot_reader
+{
+public:
+    Snapshot_reader(const char* begin_, const char* end_)
+        : pos(begin_)
+        , end(end_)
+    { }
+
+    const char* read_bytes(size_t size)
+    {
+        if (static_cast<size_t>(end - pos) < size)
+            throw Error("Invalid data found in file!");
+        const char* bytes = pos;
+        pos += size;
+        return bytes;
+    }
+    uint32_t read_u32()
+    {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(read_bytes(4));
+        return bytes[0] | bytes[1] << 8 | bytes[2] << 16 | static_cast<uint32_t>(bytes[3]) << 24;
+    }
+    int read_i32()
+    {
+        return static_cast<int>(read_u32());
+    }
+    // The view points into the mapped file
+    string_view read_string()
+    {
+        uint32_t size = read_u32();
+        return string_view(read_bytes(size), size);
+    }
+    bool at_end() const
+    {
+        return pos == end;
+    }
+
+private:
+    const char* pos;
+    const char* end;
+};
+
+// The lines of a mapped text file, without their newlines
+class Text_lines
+{
+public:
+    Text_lines(const char* begin, const char* end)
+    {
+        const char* pos = begin;
+        while (pos != end) {
+            starts.push_back(pos);
+            const char* newline = static_cast<const char*>(memchr(pos, '\n', end - pos));
+            pos = newline != nullptr ? newline + 1 : end;
+        }
+        starts.push_back(end);
+        file_end = end;
+    }
+
+    size_t size() const
+    {
+        return starts.size() - 1;
+    }
+    string_view operator[](size_t i) const
+    {
+        const char* line_end = starts[i + 1];
+        if (line_end != starts[i] && (line_end != file_end || line_end[-1] == '\n'))
+            --line_end;
+        return string_view(starts[i], line_end - starts[i]);
+    }
+
+private:
+    // Where each line starts, then the end of the file
+    vector<const char*> starts;
+    const char* file_end;
+};
+
+// Reads whitespace-separated fields from the start of a line
+class Line_reader
+{
+public:
+    Line_reader(string_view line_)
+        : line(line_)
+    { }
+
+    // Read an integer after any whitespace. Return false if there is none.
+    bool read_int(int& value)
+    {
+        skip_white();
+        from_chars_result result = from_chars(line.data(), line.data() + line.size(), value);
+        if (result.ec != errc())
+            return false;
+        line.remove_prefix(result.ptr - line.data());
+        return true;
+    }
+
+    // Read a run of non-whitespace characters after any whitespace.
+    // Return false if there is none.
+    bool read_word(string_view& word)
+    {
+        skip_white();
+        size_t size = 0;
+        while (size < line.size() && !isspace(static_cast<unsigned char>(line[size])))
+            ++size;
+        word = line.substr(0, size);
+        line.remove_prefix(size);
+        return size > 0;
+    }
+
+    // Return the rest of the line after the one character that separates
+    // it from the last field, or false if there is no such character.
+    bool read_rest(string_view& rest)
+    {
+        if (line.empty())
+            return false;
+        rest = line.substr(1);
+        return true;
+    }
+
+    // Return true if only whitespace is left
+    bool at_end()
+    {
+        skip_white();
+        return line.empty();
+    }
+
+private:
+    void skip_white()
+    {
+        while (!line.empty() && isspace(static_cast<unsigned char>(line.front())))
+            line.remove_prefix(1);
+    }
+
+    string_view line;
+};
+
+// Read a count that is alone on its line. Throw an Error if there is no
+// such line or the count is negative.
+int read_count(const Text_lines& lines, size_t line)
+{
+    int count;
+    if (line >= lines.size())
+        throw Error("Invalid data found in file!");
+    Line_reader reader(lines[line]);
+    if (!reader.read_int(count) || !reader.at_end() || count < 0)
+        throw Error("Invalid data found in file!");
+    return count;
+}
+
+// Return true if the ID is one a Record can have: positive, and short
+// of the largest int so that the next ID after it is one too
+bool is_valid_id(int id)
+{
+    return id > 0 && id < numeric_limits<int>::max();
+}
+
+// Return true if the rating is one a Record can have: 0 for unrated,
+// or 1 to 5
+bool is_valid_rating(int rating)
+{
+    return rating >= 0 && rating <= 5;
+}
+
+// Parse a Record's line in save format: ID, medium, rating, and title.
+// Throw an Error if the line does not hold a Record.
+Record_row parse_record(string_view line)
+{
+    Record_row row;
+    Line_reader reader(line);
+    if (!reader.read_int(row.id) || !reader.read_word(row.medium) || !reader.read_int(row.rating)
+        || !reader.read_rest(row.title) || !is_valid_id(row.id) || !is_valid_rating(row.rating))
+        throw Error("Invalid data found in file!");
+    return row;
+}
+
+// A Collection's name and the lines that hold its members' titles
+struct Collection_lines
+{
+    string_view name;
+    size_t first_member;
+    int num_member;
+};
+
+}  // namespace
+
+// Write the Library and then the Catalog to the named file in text
+// format. Throw an Error if the file cannot be opened for output.
+void save_text_snapshot(const string& file_name, const Library& lib, const Catalog& cat)
+{
+    ofstream myfile(file_name);
+    if (!myfile.is_open())
+        throw Error("Could not open file!");
+
+    myfile << lib.size() << '\n';
+
+    // Save each Record to the specified file first
+    for_each(lib.begin(), lib.end(), [&](Record* record) { record->save(myfile); });
+
+    myfile << cat.size() << '\n';
+
+    // Save each Collection to the file
+    for_each(cat.cbegin(), cat.cend(), [&](const Collection& collection) { collection.save(myfile, lib); });
+
+    myfile.close();
+    if (!myfile)
+        throw Error("Could not write file!");
+}
+
+// Restore the Library and Catalog from the named text file into the
+// given empty Library and Catalog. The file is mapped and split into
+// lines; the Record lines are parsed on all threads, the Library builds
+// its indexes in parallel, and then each Collection's member titles are
+// looked up on all threads. Throw an Error if the file cannot be opened,
+// ends early, has a negative or invalid number, a Record whose ID or
+// title is taken twice, or a member title that is not in the Library.
+void restore_text_snapshot(const string& file_name, Library& lib, Catalog& cat)
+{
+    Mapped_file file(file_name);
+    Text_lines lines(file.begin(), file.end());
+
+    size_t line = 0;
+    int num_record = read_count(lines, line++);
+    if (lines.size() - line < static_cast<size_t>(num_record))
+        throw Error("Invalid data found in file!");
+
+    // The rows point into the mapped file until the Records are created
+    vector<Record_row> rows(num_record);
+    parallel_for(num_record, 4096, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            rows[i] = parse_record(lines[line + i]);
+    });
+    line += num_record;
+
+    if (!lib.restore_records(rows))
+        throw Error("Invalid data found in file!");
+
+    // Find where each Collection's members are listed
+    int num_collection = read_count(lines, line++);
+    vector<Collection_lines> collections;
+    for (int j = 0; j < num_collection; ++j) {
+        if (line >= lines.size())
+            throw Error("Invalid data found in file!");
+
+        Collection_lines col_lines;
+        Line_reader reader(lines[line++]);
+        if (!reader.read_word(col_lines.name) || !reader.read_int(col_lines.num_member) || col_lines.num_member < 0
+            || lines.size() - line < static_cast<size_t>(col_lines.num_member))
+            throw Error("Invalid data found in file!");
+
+        col_lines.first_member = line;
+        line += col_lines.num_member;
+        collections.push_back(col_lines);
+    }
+
+    // Look up the member titles; the Library is only read meanwhile
+    vector<vector<int>> member_ids(collections.size());
+    parallel_for(collections.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t j = begin; j < end; ++j) {
+            for (int k = 0; k < collections[j].num_member; ++k) {
+                Record* record_ptr = lib.find_title(lines[collections[j].first_member + k]);
+                if (record_ptr == nullptr)
+                    throw Error("Invalid data found in file!");
+                member_ids[j].push_back(record_ptr->get_ID());
+            }
+        }
+    });
+
+    // A name that is already taken means the file is corrupt
+    for (size_t j = 0; j < collections.size(); ++j) {
+        if (cat.add(Collection(string(collections[j].name), member_ids[j], lib), lib) == nullptr)
+            throw Error("Invalid data found in file!");
+    }
+}
+
+// Write the Library and Catalog to the named file, in the binary format
+// if the name selects it and in the text format otherwise. The data goes
+// to a temporary file that is synced and then renamed over the named
+// file, so the file is never left half written. Throw an Error if the
+// file cannot be opened or written; the named file is then untouched.
+void save_snapshot(const string& file_name, const Library& lib, const Catalog& cat)
+{
+    string temp_name = file_name + ".tmp";
+    try {
+        if (is_binary_snapshot(file_name))
+            save_binary_snapshot(temp_name, lib, cat);
+        else
+            save_text_snapshot(temp_name, lib, cat);
+
+        if (!sync_to_disk(temp_name) || rename(temp_name.c_str(), file_name.c_str()) != 0)
+            throw Error("Could not write file!");
+    } catch (Error&) {
+        remove(temp_name.c_str());
+        throw;
+    }
+    sync_to_disk(directory_of(file_name));
+}
+
+// Return true if the file name selects the binary snapshot format.
+bool is_binary_snapshot(const string& file_name)
+{
+    const string extension = ".bin";
+    return file_name.size() > extension.size()
+        && file_name.compare(file_name.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+// Write the Library and Catalog to the named file in binary snapshot
+// format and return its checksum. Throw an Error if the file cannot be
+// opened for output.
+uint64_t save_binary_snapshot(const string& file_name, const Library& lib, const Catalog& cat)
+{
+    ofstream myfile(file_name, ios::binary);
+    if (!myfile.is_open())
+        throw Error("Could not open file!");
+
+    Snapshot_writer writer(myfile);
+    writer.write_bytes(snapshot_magic, sizeof(snapshot_magic));
+    writer.write_u32(snapshot_version);
+
+    // Give each distinct medium an index in the string table. Records
+    // share interned media, so the medium's address identifies it.
+    vector<const string*> media;
+    unordered_map<const string*, uint32_t> medium_index;
+    for_each(lib.begin(), lib.end(), [&](const Record* record) {
+        if (medium_index.emplace(&record->get_medium(), media.size()).second)
+            media.push_back(&record->get_medium());
+    });
+
+    writer.write_u32(media.size());
+    for_each(media.cbegin(), media.cend(), [&](const string* medium) { writer.write_string(*medium); });
+
+    writer.write_u32(lib.size());
+    for_each(lib.begin(), lib.end(), [&](const Record* record) {
+        writer.write_i32(record->get_ID());
+        writer.write_u32(medium_index.find(&record->get_medium())->second);
+        writer.write_i32(record->get_rating());
+        writer.write_string(record->get_title());
+    });
+
+    // Collections store their members by Record ID
+    writer.write_u32(cat.size());
+    for_each(cat.cbegin(), cat.cend(), [&](const Collection& collection) {
+        writer.write_string(collection.get_name());
+        writer.write_u32(collection.size());
+        collection.for_each_member_id([&](int id) { writer.write_i32(id); });
+    });
+
+    uint64_t checksum = writer.write_checksum();
+    myfile.close();
+    if (!myfile)
+        throw Error("Could not write file!");
+    return checksum;
+}
+
+// Restore the Library and Catalog from the named binary snapshot into
+// the given empty Library and Catalog. Throw an Error if the file cannot
+// be opened, or if it is truncated, has the wrong version or fails its
+// checksum. Return the snapshot's checksum, which identifies it.
+uint64_t restore_binary_snapshot(const string& file_name, Library& lib, Catalog& cat)
+{
+    Mapped_file file(file_name);
+
+    // Verify the checksum before looking at any of the data
+    const size_t checksum_size = 8;
+    if (static_cast<size_t>(file.end() - file.begin()) < sizeof(snapshot_magic) + 4 + checksum_size)
+        throw Error("Invalid data found in file!");
+    const char* payload_end = file.end() - checksum_size;
+
+    Snapshot_reader checksum_reader(payload_end, file.end());
+    uint64_t stored_checksum = checksum_reader.read_u32();
+    stored_checksum |= static_cast<uint64_t>(checksum_reader.read_u32()) << 32;
+    if (fnv1a(fnv_offset_basis, file.begin(), payload_end - file.begin()) != stored_checksum)
+        throw Error("Invalid data found in file!");
+
+    Snapshot_reader reader(file.begin(), payload_end);
+    if (memcmp(reader.read_bytes(sizeof(snapshot_magic)), snapshot_magic, sizeof(snapshot_magic)) != 0
+        || reader.read_u32() != snapshot_version)
+        throw Error("Invalid data found in file!");
+
+    vector<string_view> media(reader.read_u32());
+    for (string_view& medium : media)
+        medium = reader.read_string();
+
+    // The rows point into the mapped file until the Records are created
+    uint32_t num_record = reader.read_u32();
+    vector<Record_row> rows;
+    rows.reserve(min<size_t>(num_record, (payload_end - file.begin()) / 16));
+    for (uint32_t i = 0; i < num_record; ++i) {
+        int id = reader.read_i32();
+        uint32_t medium = reader.read_u32();
+        int rating = reader.read_i32();
+        string_view title = reader.read_string();
+        if (medium >= media.size() || !is_valid_id(id) || !is_valid_rating(rating))
+            throw Error("Invalid data found in file!");
+        rows.push_back(Record_row{id, media[medium], title, rating});
+    }
+    if (!lib.restore_records(rows))
+        throw Error("Invalid data found in file!");
+
+    // Collections were saved in name order, so a name that does not come
+    // after the one before it is a duplicate or a corrupt file
+    uint32_t num_collection = reader.read_u32();
+    string last_name;
+    for (uint32_t j = 0; j < num_collection; ++j) {
+        string name(reader.read_string());
+        if (j > 0 && !(last_name < name))
+            throw Error("Invalid data found in file!");
+
+        Collection& collection = *cat.add(name);
+        last_name = move(name);
+
+        uint32_t num_member = reader.read_u32();
+        for (uint32_t k = 0; k < num_member; ++k) {
+            Record* record_ptr = lib.find_id(reader.read_i32());
+            if (record_ptr == nullptr || collection.is_member_present(record_ptr))
+                throw Error("Invalid data found in file!");
+            collection.add_member(record_ptr, lib);
+        }
+    }
+
+    if (!reader.at_end())
+        throw Error("Invalid data found in file!");
+    return stored_checksum;
+}
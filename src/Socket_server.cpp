@@ -0,0 +1,157 @@
+#include "Socket_server.h"
+#include "Utility.h"
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+// Connections waiting to be accepted are queued up to this many
+const int listen_backlog = 128;
+
+}  // namespace
+
+// Listen on the socket with the given path, replacing a socket left
+// there by an earlier server. Throw an Error if it cannot be made.
+Socket_server::Socket_server(const string& path_)
+    : path(path_)
+    , listen_fd(-1)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path))
+        throw Error("Invalid socket path!");
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    // Only a socket is replaced, never another kind of file
+    struct stat file_stat;
+    if (lstat(path.c_str(), &file_stat) == 0 && S_ISSOCK(file_stat.st_mode))
+        unlink(path.c_str());
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0)
+        throw Error("Could not listen on socket!");
+    if (bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+        || listen(listen_fd, listen_backlog) != 0) {
+        close(listen_fd);
+        throw Error("Could not listen on socket!");
+    }
+}
+
+// Stop listening and remove the socket
+Socket_server::~Socket_server()
+{
+    close(listen_fd);
+    unlink(path.c_str());
+}
+
+// Run the session for each client until SIGINT or SIGTERM arrives, then
+// wait for the sessions to end. The signals are blocked on every thread
+// and taken here with sigwait, so no handler interrupts a session.
+void Socket_server::run(const Session& session)
+{
+    sigset_t stop_signals, old_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, &old_signals);
+
+    thread acceptor(&Socket_server::accept_clients, this, cref(session));
+
+    int signal_number;
+    sigwait(&stop_signals, &signal_number);
+
+    // Shutting the listening socket down wakes the acceptor
+    shutdown(listen_fd, SHUT_RDWR);
+    acceptor.join();
+
+    {
+        lock_guard<mutex> lock(clients_mutex);
+        for (Client& client : clients)
+            shutdown(client.fd, SHUT_RD);
+    }
+    for (Client& client : clients) {
+        client.worker.join();
+        close(client.fd);
+    }
+    clients.clear();
+
+    pthread_sigmask(SIG_SETMASK, &old_signals, nullptr);
+}
+
+// Accept clients and start their sessions until the listening socket
+// is shut down
+void Socket_server::accept_clients(const Session& session)
+{
+    while (true) {
+        int client_fd = accept(listen_fd, nullptr, nullptr);
+        if (client_fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            return;
+        }
+
+        collect_done_clients();
+
+        lock_guard<mutex> lock(clients_mutex);
+        clients.push_back(Client{client_fd, thread(), false});
+        Client& client = clients.back();
+        client.worker = thread([this, &client, &session] {
+            session(client.fd);
+            // The client sees the end of the connection now; the
+            // descriptor stays open until the thread is collected
+            shutdown(client.fd, SHUT_RDWR);
+            lock_guard<mutex> lock(clients_mutex);
+            client.is_done = true;
+        });
+    }
+}
+
+// Wait for the sessions that have ended and close their connections
+void Socket_server::collect_done_clients()
+{
+    list<Client> done;
+    {
+        lock_guard<mutex> lock(clients_mutex);
+        for (auto it = clients.begin(); it != clients.end();) {
+            auto next = std::next(it);
+            if (it->is_done)
+                done.splice(done.end(), clients, it);
+            it = next;
+        }
+    }
+    for (Client& client : done) {
+        client.worker.join();
+        close(client.fd);
+    }
+}
+
+Socket_writer::int_type Socket_writer::overflow(int_type ch)
+{
+    if (traits_type::eq_int_type(ch, traits_type::eof()))
+        return traits_type::not_eof(ch);
+
+    char c = traits_type::to_char_type(ch);
+    return xsputn(&c, 1) == 1 ? ch : traits_type::eof();
+}
+
+// Send all of the data, retrying short writes. Return how much was sent.
+streamsize Socket_writer::xsputn(const char* s, streamsize n)
+{
+    streamsize sent = 0;
+    while (sent < n) {
+        ssize_t size = send(fd, s + sent, n - sent, MSG_NOSIGNAL);
+        if (size < 0 && errno == EINTR)
+            continue;
+        if (size <= 0)
+            break;
+        sent += size;
+    }
+    return sent;
+}
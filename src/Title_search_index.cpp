@@ -0,0 +1,229 @@
+#include "Title_search_index.h"
+#include "Case_fold_search.h"
+#include "Parallel.h"
+#include "Utility.h"
+#include <algorithm>
+#include <cctype>
+#include <utility>
+
+using namespace std;
+
+namespace {
+
+// Queries shorter than a trigram cannot use the posting lists
+const size_t trigram_size = 3;
+
+// Scans are split into parts of at least this many titles
+const size_t min_titles_per_part = 4096;
+
+char fold(char c)
+{
+    return static_cast<char>(tolower(static_cast<unsigned char>(c)));
+}
+
+uint32_t trigram_key(const char* chars)
+{
+    return static_cast<unsigned char>(chars[0]) << 16 | static_cast<unsigned char>(chars[1]) << 8
+        | static_cast<unsigned char>(chars[2]);
+}
+
+}  // namespace
+
+// Call func with each distinct trigram of the lower-cased string
+template <typename F>
+void Title_search_index::for_each_trigram(string_view lowered, F func)
+{
+    if (lowered.size() < trigram_size)
+        return;
+
+    vector<uint32_t> keys;
+    keys.reserve(lowered.size() - trigram_size + 1);
+    for (size_t i = 0; i + trigram_size <= lowered.size(); ++i)
+        keys.push_back(trigram_key(lowered.data() + i));
+
+    sort(keys.begin(), keys.end());
+    keys.erase(unique(keys.begin(), keys.end()), keys.end());
+    for_each(keys.cbegin(), keys.cend(), func);
+}
+
+// Index the Record under its current title.
+void Title_search_index::insert(Record* record_ptr)
+{
+    int id = record_ptr->get_ID();
+    string_view title = record_ptr->get_title();
+    Entry entry{record_ptr, folded.size(), title.size()};
+    transform(title.cbegin(), title.cend(), back_inserter(folded), fold);
+    folded.push_back('\0');
+    entries.insert(id, entry);
+    buffer_order.emplace_back(entry.offset, id);
+
+    // IDs mostly arrive in increasing order, so a new ID usually goes
+    // on the end of each posting list.
+    for_each_trigram(folded_title(entry), [&](uint32_t key) {
+        Counted_vector<int>& ids = postings[key];
+        if (ids.empty() || ids.back() < id)
+            ids.push_back(id);
+        else
+            ids.insert(lower_bound(ids.begin(), ids.end(), id), id);
+    });
+}
+
+// Stop indexing the Record; call before its title changes.
+void Title_search_index::erase(Record* record_ptr)
+{
+    int id = record_ptr->get_ID();
+    const Entry& entry = *entries.find(id);
+
+    for_each_trigram(folded_title(entry), [&](uint32_t key) {
+        auto it = postings.find(key);
+        Counted_vector<int>& ids = it->second;
+        ids.erase(lower_bound(ids.begin(), ids.end(), id));
+        if (ids.empty())
+            postings.erase(it);
+    });
+
+    dead_bytes += entry.size + 1;
+    entries.erase(id);
+
+    if (dead_bytes > folded.size() / 2)
+        compact();
+}
+
+// Return the Records whose lower-cased titles contain the lower-cased
+// string, in alphabetical order of title. The titles are checked in
+// parts on the pool's threads; each part's matches are sorted there, and
+// the sorted parts are merged in order, so the result is the same however
+// the work is split.
+vector<Record*> Title_search_index::find(string_view lowered) const
+{
+    vector<vector<Record*>> parts;
+    if (lowered.size() < trigram_size) {
+        parts = parallel_collect(buffer_order.size(), min_titles_per_part, [&](size_t first, size_t last) {
+            vector<Record*> found = scan_titles(first, last, lowered);
+            sort(found.begin(), found.end(), Title_compare());
+            return found;
+        });
+    } else {
+        // Gather the query's posting lists, shortest first. A trigram
+        // with no posting list means nothing can match.
+        vector<const Counted_vector<int>*> lists;
+        bool missing = false;
+        for_each_trigram(lowered, [&](uint32_t key) {
+            auto it = postings.find(key);
+            if (it == postings.end())
+                missing = true;
+            else
+                lists.push_back(&it->second);
+        });
+        if (missing)
+            return vector<Record*>();
+
+        sort(lists.begin(), lists.end(), [](const Counted_vector<int>* l1, const Counted_vector<int>* l2) {
+            return l1->size() < l2->size();
+        });
+
+        // Candidates must be on every list; the trigrams do not say where
+        // in the title they occur, so each candidate is then checked.
+        vector<int> candidates(lists.front()->cbegin(), lists.front()->cend());
+        for (auto it = lists.cbegin() + 1; it != lists.cend() && !candidates.empty(); ++it) {
+            vector<int> both;
+            set_intersection(
+                candidates.cbegin(), candidates.cend(), (*it)->cbegin(), (*it)->cend(), back_inserter(both));
+            candidates.swap(both);
+        }
+        parts = parallel_collect(candidates.size(), min_titles_per_part, [&](size_t first, size_t last) {
+            vector<Record*> found;
+            for (size_t i = first; i < last; ++i) {
+                const Entry* entry = entries.find(candidates[i]);
+                if (entry != nullptr && find_case_insensitive(folded_title(*entry), lowered) != string_view::npos)
+                    found.push_back(entry->record_ptr);
+            }
+            sort(found.begin(), found.end(), Title_compare());
+            return found;
+        });
+    }
+
+    // Merge neighbouring runs of sorted parts, doubling the run length
+    vector<Record*> found;
+    vector<size_t> part_begins;
+    for (const vector<Record*>& part : parts) {
+        part_begins.push_back(found.size());
+        found.insert(found.end(), part.cbegin(), part.cend());
+    }
+    part_begins.push_back(found.size());
+    for (size_t width = 1; width < parts.size(); width *= 2) {
+        for (size_t i = 0; i + width < parts.size(); i += 2 * width) {
+            inplace_merge(found.begin() + part_begins[i],
+                found.begin() + part_begins[i + width],
+                found.begin() + part_begins[min(i + 2 * width, parts.size())],
+                Title_compare());
+        }
+    }
+    return found;
+}
+
+// Return the Records whose lower-cased titles contain the lower-cased
+// string, among the titles listed in buffer_order from first up to last,
+// in buffer order. That part of the buffer is scanned in one pass; each
+// match is looked up in the buffer order and the scan resumes after the
+// title it fell in.
+vector<Record*> Title_search_index::scan_titles(size_t first, size_t last, string_view lowered) const
+{
+    vector<Record*> found;
+    size_t end = last < buffer_order.size() ? buffer_order[last].first : folded.size();
+    string_view buffer(folded.data(), end);
+    size_t pos = first < buffer_order.size() ? buffer_order[first].first : end;
+    while (pos < buffer.size()) {
+        size_t hit = find_case_insensitive(buffer.substr(pos), lowered);
+        if (hit == string_view::npos)
+            break;
+
+        auto title_it = upper_bound(buffer_order.cbegin() + first,
+                            buffer_order.cbegin() + last,
+                            pos + hit,
+                            [](size_t offset, const pair<size_t, int>& title) { return offset < title.first; })
+            - 1;
+        const Entry* entry = entries.find(title_it->second);
+        if (entry != nullptr && entry->offset == title_it->first)
+            found.push_back(entry->record_ptr);
+
+        pos = folded.find('\0', pos + hit) + 1;
+    }
+    return found;
+}
+
+void Title_search_index::clear()
+{
+    folded.clear();
+    dead_bytes = 0;
+    buffer_order.clear();
+    entries.clear();
+    postings.clear();
+}
+
+void Title_search_index::swap(Title_search_index& other)
+{
+    folded.swap(other.folded);
+    std::swap(dead_bytes, other.dead_bytes);
+    buffer_order.swap(other.buffer_order);
+    entries.swap(other.entries);
+    postings.swap(other.postings);
+}
+
+// Rebuild the buffer without the titles of erased Records
+void Title_search_index::compact()
+{
+    Buffer_t live;
+    live.reserve(folded.size() - dead_bytes);
+    buffer_order.clear();
+    for (const Entry& entry : entries) {
+        int id = entry.record_ptr->get_ID();
+        size_t offset = live.size();
+        live.append(folded_title(entry));
+        live.push_back('\0');
+        entries.find(id)->offset = offset;
+        buffer_order.emplace_back(offset, id);
+    }
+    folded.swap(live);
+    dead_bytes = 0;
+}
@@ -1,18 +1,23 @@
 #include "Utility.h"
+#include "Input_reader.h"
 #include <algorithm>
+#include <cctype>
 #include <iostream>
 #include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
 
 using namespace std;
 
 // Perform lower_bound on the library to look for a Record
 // Return a pair whose first member is an iterator to a member
-// of the vector while second member is a bool indicating whether the
+// of the set while second member is a bool indicating whether the
 // Record was found or not.
-pair<Lib_ti_iter, bool> lib_binary_search(const Lib_ti_t& lib_ti, const string& title)
+// The set's own lower_bound walks the tree in O(log n); the generic
+// std::lower_bound would be linear on the set's bidirectional iterators.
+pair<Lib_ti_iter, bool> lib_binary_search(const Lib_ti_t& lib_ti, string_view title)
 {
-    Title_hetero_compare func;
-    Lib_ti_iter iter_found = lower_bound(lib_ti.cbegin(), lib_ti.cend(), title, func);
+    Lib_ti_iter iter_found = lib_ti.lower_bound(title);
 
     // Case when the a matching Record is found
     if (iter_found != lib_ti.cend() && (*iter_found)->get_title() == title) {
@@ -24,31 +29,87 @@ pair<Lib_ti_iter, bool> lib_binary_search(const Lib_ti_t& lib_ti, const string&
     return it_bool;
 }
 
+// Return the first eight bytes of the title as a big-endian number,
+// padded with zero bytes, so that comparing two prefixes orders the
+// titles the same way comparing the titles does, unless they are equal.
+uint64_t title_prefix(string_view title)
+{
+    uint64_t prefix = 0;
+    for (size_t i = 0; i < 8; ++i) {
+        prefix <<= 8;
+        if (i < title.size())
+            prefix |= static_cast<unsigned char>(title[i]);
+    }
+    return prefix;
+}
+
+// Return the text without its leading and trailing whitespace, and with
+// each run of whitespace inside it cut down to its first character.
+string remove_unneeded_white(string_view text)
+{
+    string result;
+    result.reserve(text.size());
+
+    // A whitespace character is only added once a non-white
+    // character follows it
+    bool white_pending = false;
+    char white = ' ';
+    for (char c : text) {
+        if (isspace(static_cast<unsigned char>(c))) {
+            if (!result.empty() && !white_pending) {
+                white_pending = true;
+                white = c;
+            }
+            continue;
+        }
+        if (white_pending) {
+            result.push_back(white);
+            white_pending = false;
+        }
+        result.push_back(c);
+    }
+    return result;
+}
+
+// Return true if remove_unneeded_white would leave the text unchanged.
+bool is_free_of_unneeded_white(string_view text)
+{
+    bool last_white = true;
+    for (char c : text) {
+        bool white = isspace(static_cast<unsigned char>(c));
+        if (white && last_white)
+            return false;
+        last_white = white;
+    }
+    return !last_white || text.empty();
+}
+
 // Read an integer and throw an Error if it is not an integer
-int read_and_check_integer()
+int read_and_check_integer(Input_reader& input)
 {
     int value;
-    cin >> value;
-
-    if (!cin.good()) {
-        cin.clear();
+    if (!input.read_int(value))
         throw Error("Could not read an integer value!");
-    }
 
     return value;
 }
 
-// Check if stream is good and throw an Error if it is not.
-void check_stream_state(ifstream& is)
+// Flush the named file or directory to the disk. Return false on failure.
+bool sync_to_disk(const string& path)
 {
-    if (!is.good())
-        throw Error("Invalid data found in file!");
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    bool synced = fsync(fd) == 0;
+    close(fd);
+    return synced;
 }
 
-// Check if stream is good and value is not negative. Throw an Error
-// if the stream is not good or if the value is negative.
-void check_stream_state_and_value(std::ifstream& is, int value)
+// Return the directory that holds the named file
+string directory_of(const string& file_name)
 {
-    if (!is.good() || value < 0)
-        throw Error("Invalid data found in file!");
-}
\ No newline at end of file
+    size_t slash = file_name.find_last_of('/');
+    if (slash == string::npos)
+        return ".";
+    return slash == 0 ? "/" : file_name.substr(0, slash);
+}
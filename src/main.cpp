@@ -1,100 +1,137 @@
+#include "Background_save.h"
+#include "Catalog.h"
 #include "Collection.h"
+#include "Command_stats.h"
+#include "Command_table.h"
+#include "Epoch.h"
+#include "Import.h"
+#include "Input_reader.h"
+#include "Journal.h"
+#include "Library.h"
+#include "Library_version.h"
+#include "Memory_usage.h"
+#include "Output_buffer.h"
+#include "Parallel.h"
 #include "Record.h"
+#include "Snapshot.h"
+#include "Socket_server.h"
 #include "Utility.h"
 #include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
 #include <fstream>
 #include <functional>
 #include <iostream>
 #include <iterator>
-#include <map>
+#include <memory>
+#include <mutex>
 #include <set>
-#include <stdexcept>
+#include <shared_mutex>
+#include <sstream>
 #include <string>
+#include <string_view>
+#include <unistd.h>
 #include <utility>
 #include <vector>
 
 using namespace std;
-using namespace std::placeholders;
-
-using Cat_t = vector<Collection>;
-using Cat_citer = vector<Collection>::const_iterator;
-
-// Functor used for ordering Records in an ascending ID.
-struct ID_compare
-{
-    bool operator()(const Record* r1, const Record* r2) const
-    {
-        return r1->get_ID() < r2->get_ID();
-    }
-};
-
-using Lib_id_t = set<Record*, ID_compare>;
-using Lib_id_iter = set<Record*, ID_compare>::iterator;
 
 // Find commands
-void fr_command(const Lib_ti_t& lib_ti, const Lib_id_t&, const Cat_t&, const int&);
-void fs_command(const Lib_ti_t& lib_ti, const Lib_id_t&, const Cat_t&, const int&);
+void fr_command(const Library& lib, const Catalog&);
+void fs_command(const Library& lib, const Catalog&);
 
 // Print commands
-void pr_command(const Lib_ti_t&, const Lib_id_t& lib_id, const Cat_t&, const int&);
-void pc_command(const Lib_ti_t&, const Lib_id_t&, const Cat_t& cat, const int&);
-void pL_command(const Lib_ti_t& lib_ti, const Lib_id_t&, const Cat_t&, const int&);
-void pC_command(const Lib_ti_t&, const Lib_id_t&, const Cat_t& cat, const int&);
-void pa_command(const Lib_ti_t& lib_ti, const Lib_id_t&, const Cat_t& cat, const int&);
-
-// List command
-void lr_command(const Lib_ti_t& lib_ti, const Lib_id_t&, const Cat_t&, const int&);
+void pr_command(const Library& lib, const Catalog&);
+void pc_command(const Library& lib, const Catalog& cat);
+void pL_command(const Library& lib, const Catalog&);
+void pC_command(const Library& lib, const Catalog& cat);
+void pa_command(const Library& lib, const Catalog& cat);
+void ps_command(Library&, Catalog&);
+
+// List commands
+void lr_command(const Library& lib, const Catalog&);
+void lt_command(const Library& lib, const Catalog&);
+void lb_command(const Library& lib, const Catalog&);
 
 // Collection stats & combine commands
-void cs_command(const Lib_ti_t& lib_ti, const Lib_id_t&, const Cat_t& cat, const int&);
-void cc_command(const Lib_ti_t&, const Lib_id_t&, Cat_t& cat, const int&);
+void cs_command(const Library& lib, const Catalog&);
+void cc_command(Library& lib, Catalog& cat);
+void ci_command(Library& lib, Catalog& cat);
+void cd_command(Library& lib, Catalog& cat);
+void cu_command(Library& lib, Catalog& cat);
 
 // Add commands
-void ar_command(Lib_ti_t& lib_ti, Lib_id_t& lib_id, const Cat_t&, int& record_id);
-void ac_command(const Lib_ti_t&, const Lib_id_t&, Cat_t& cat, const int&);
-void am_command(const Lib_ti_t&, const Lib_id_t& lib_id, Cat_t& cat, const int&);
+void ar_command(Library& lib, const Catalog&);
+void ac_command(const Library&, Catalog& cat);
+void am_command(Library& lib, Catalog& cat);
 
 // Modify command
-void mr_command(const Lib_ti_t&, const Lib_id_t& lib_id, const Cat_t&, const int&);
-void mt_command(Lib_ti_t& lib_ti, Lib_id_t& lib_id, Cat_t& cat, const int&);
+void mr_command(Library& lib, const Catalog&);
+void mt_command(Library& lib, const Catalog&);
 
 // Delete commands
-void dr_command(Lib_ti_t& lib_ti, Lib_id_t& lib_id, const Cat_t& cat, const int&);
-void dc_command(const Lib_ti_t&, const Lib_id_t&, Cat_t& cat, const int&);
-void dm_command(const Lib_ti_t&, const Lib_id_t& lib_id, Cat_t& cat, const int&);
+void dr_command(Library& lib, const Catalog&);
+void dc_command(Library& lib, Catalog& cat);
+void dm_command(Library& lib, Catalog& cat);
 
 // Function wrappers for cL and cC commands
-void cL_command_wrapper(Lib_ti_t& lib_ti, Lib_id_t& lib_id, const Cat_t& cat, int& record_id);
-void cC_command_wrapper(const Lib_ti_t& lib_ti, const Lib_id_t& lib_id, Cat_t& cat, const int& record_id);
+void cL_command_wrapper(Library& lib, const Catalog& cat);
+void cC_command_wrapper(Library& lib, Catalog& cat);
 
 // Clear commands
-void cL_command(Lib_ti_t& lib_ti, Lib_id_t& lib_id, const Cat_t& cat, int& record_id);
-void cC_command(const Lib_ti_t&, const Lib_id_t&, Cat_t& cat, const int&);
-void cA_command(Lib_ti_t& lib_ti, Lib_id_t& lib_id, Cat_t& cat, int& record_id);
+void cL_command(Library& lib, const Catalog& cat);
+void cC_command(Library& lib, Catalog& cat);
+void cA_command(Library& lib, Catalog& cat);
 
 // Save & restore commands
-void sA_command(const Lib_ti_t& lib_ti, const Lib_id_t&, const Cat_t& cat, const int&);
-void rA_command(Lib_ti_t& lib_ti, Lib_id_t& lib_id, Cat_t& cat, int& record_id);
+void sA_command(const Library& lib, const Catalog& cat);
+void rA_command(Library& lib, Catalog& cat);
+
+// Import command
+void iL_command(Library& lib, const Catalog& cat);
 
 // Quit command
-void qq_command(Lib_ti_t& lib_ti, Lib_id_t& lib_id, Cat_t& cat, int& record_id);
+void qq_command(Library& lib, Catalog& cat);
 
 // Helper functions used for main
 void skip_rest_of_line(const char* error_msg);
-void print_and_clear_data(const char* error_msg, Lib_ti_t& lib_ti, Lib_id_t& lib_id, Cat_t& cat, int& record_id);
+void report_error(const char* error_msg);
+void print_and_clear_data(const char* error_msg, Library& lib, Catalog& cat);
+string_view read_word();
+void run_command(const Command_table::Command& command, int index, Library& lib, Catalog& cat);
+
+// Helper functions for the journal
+void journal_change(const string& change);
+void journal_checkpoint(const Library& lib, const Catalog& cat);
+void replay_changes(const vector<string>& changes, const Command_table& commands, Library& lib, Catalog& cat);
+
+// Helper functions for the server
+bool is_lock_free_command(char first_char, char second_char);
+bool is_read_only_command(char first_char, char second_char);
+void run_change(const Command_table::Command& command, int index, Library& lib, Catalog& cat);
+void run_session(int client_fd, const Command_table& commands, Library& lib, Catalog& cat);
+
+// Helper functions for batches
+void queue_record(Library& lib, const string& medium, string_view title);
+void add_queued_records(Library& lib);
+void report_batch_error(long long command_number, const char* error_msg);
+bool is_transaction_failed();
+int end_batch(const Command_table& commands, Journal* journal, Library& lib, Catalog& cat);
 
 // Helper functions for Collection commands
-Collection& find_collection_ref(Cat_t& cat);
-const Collection& find_const_collection(const Cat_t& cat);
-Cat_citer find_collection_iter(const Cat_t& cat);
-Cat_citer find_and_check_if_already_present(const Cat_t& cat, const string& name);
-pair<Cat_citer, bool> cat_binary_search(const Cat_t& cat, const string& name);
+Collection& find_collection_ref(Catalog& cat);
+const Collection& find_const_collection(const Catalog& cat);
+void check_if_already_present(const Catalog& cat, string_view name);
 
 // Helper functions for Record commands
-Lib_id_iter find_record_iter(const Lib_id_t& lib_id);
-Lib_ti_iter find_record_iter(const Lib_ti_t& lib_ti);
+Record* find_record_ptr(const Library& lib);
+Record* find_record_by_title(const Library& lib);
 int read_record_id();
-string read_title();
+string_view read_title();
+void print_entries(const vector<const Record_entry*>& entries);
 
 // Title error struct to indicate that there is no need to skip line
 struct Title_error
@@ -105,19 +142,176 @@ struct Title_error
     const char* const msg;
 };
 
-int main()
+// The input that commands read their arguments from, and the output
+// they print their results to. Each client of the server has its own.
+thread_local Input_reader* input_ptr = nullptr;
+thread_local ostream* output_ptr = &cout;
+
+// The journal that records every change, if one is kept
+Journal* journal_ptr = nullptr;
+
+// How many times each command ran and how long it took
+Command_stats* command_stats_ptr = nullptr;
+
+// The save running in the background, if saves are made that way
+Background_save* background_save_ptr = nullptr;
+
+// Where commands report the changes they make. A batch drops these
+// reports, leaving the results of other commands and the errors.
+thread_local ostream* report_ptr = &cout;
+
+// Held shared by the server's clients while they run commands that only
+// read the Library and Catalog, and exclusively while they change them
+shared_mutex data_mutex;
+
+// An ar command queued in a batch. Its medium and title are kept in
+// the batch's queued_text.
+struct Queued_record
 {
-    // Map of command function pointers
-    const map<string, function<void(Lib_ti_t&, Lib_id_t&, Cat_t&, int& record_id)>> command_map = {{"fr", fr_command},
+    long long command_number;
+    size_t medium_begin;
+    size_t title_begin;
+    size_t title_end;
+};
+
+// A batch of commands read from a script. The Records of a run of ar
+// commands are queued and added to the library together, so that its
+// indexes are updated once for the run rather than once for each.
+// A transaction is a batch that is undone if any of its commands fails.
+struct Batch
+{
+    bool is_transaction = false;
+    long long num_commands = 0;
+    long long num_failed = 0;
+    long long first_failed = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    vector<Queued_record> queued_records;
+    string queued_text;
+};
+
+// The batch being run, if commands are read from a script
+Batch* batch_ptr = nullptr;
+
+// At most this many ar commands are queued before their Records are added
+const size_t max_queued_records = 1 << 16;
+
+// The most threads that --threads accepts
+const long max_threads = 1024;
+
+// Usage: manager [--flush line|command|full] [--journal <file>] [--save foreground|background]
+//                [--threads <number>] [--memory-peaks] [-f <script> [--transaction] | --socket <path>]
+// The flush policy sets when buffered output is written; see Output_buffer.h.
+// With a journal the data is restored from it at startup and every change
+// is recorded in it; see Journal.h. In the background save mode sA saves
+// while commands keep running; see Background_save.h. With a script the
+// commands in it are run as a batch, without prompts or reports of the
+// changes made, and the program ends with a summary; as a transaction,
+// the first failure ends the batch and undoes it. With a socket the
+// commands come from the clients that connect to it; see Socket_server.h.
+// The number of threads sets how many threads scans and restores run on;
+// see Parallel.h. By default it is the number of hardware threads. With
+// --memory-peaks, pa also shows the most memory ever in use; see
+// Memory_usage.h.
+int main(int argc, char* argv[])
+{
+    const char* const usage = "Usage: manager [--flush line|command|full] [--journal <file>] "
+                              "[--save foreground|background] [--threads <number>] [--memory-peaks] "
+                              "[-f <script> [--transaction] | --socket <path>]";
+
+    Flush_policy policy = Flush_policy::command;
+    bool policy_given = false;
+    string journal_name;
+    bool save_in_background = false;
+    string script_name;
+    bool is_transaction = false;
+    string socket_path;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            if (strcmp(argv[i], "--transaction") == 0) {
+                is_transaction = true;
+                continue;
+            }
+            if (strcmp(argv[i], "--memory-peaks") == 0) {
+                track_memory_peaks();
+                continue;
+            }
+            if (i + 1 == argc)
+                throw Error(usage);
+            if (strcmp(argv[i], "--flush") == 0) {
+                policy = flush_policy_from_name(argv[++i]);
+                policy_given = true;
+            } else if (strcmp(argv[i], "-f") == 0)
+                script_name = argv[++i];
+            else if (strcmp(argv[i], "--socket") == 0)
+                socket_path = argv[++i];
+            else if (strcmp(argv[i], "--journal") == 0)
+                journal_name = argv[++i];
+            else if (strcmp(argv[i], "--threads") == 0) {
+                char* end;
+                long num_threads = strtol(argv[++i], &end, 10);
+                if (*argv[i] == '\0' || *end != '\0' || num_threads < 1 || num_threads > max_threads)
+                    throw Error(usage);
+                set_parallel_threads(num_threads);
+            }
+            else if (strcmp(argv[i], "--save") == 0) {
+                string mode = argv[++i];
+                if (mode != "foreground" && mode != "background")
+                    throw Error(usage);
+                save_in_background = mode == "background";
+            } else
+                throw Error(usage);
+        }
+        if (is_transaction && script_name.empty())
+            throw Error(usage);
+        // A server is neither a batch nor able to report background saves
+        if (!socket_path.empty() && (!script_name.empty() || save_in_background))
+            throw Error(usage);
+    } catch (Error& e) {
+        cerr << e.msg << '\n';
+        return 1;
+    }
+
+    // A batch reads its script instead of standard input. Its output is
+    // written when the buffer fills unless a flush policy was chosen.
+    int input_fd = STDIN_FILENO;
+    if (!script_name.empty()) {
+        input_fd = open(script_name.c_str(), O_RDONLY);
+        if (input_fd < 0) {
+            cerr << "Could not open file!\n";
+            return 1;
+        }
+        if (!policy_given)
+            policy = Flush_policy::full;
+    }
+
+    // Commands write to cout, which is buffered from here on. Reading a
+    // command does not flush it; the main loop does at command boundaries.
+    Output_buffer output(cout, policy);
+
+    // Commands and their arguments are read from the input in blocks
+    Input_reader input(input_fd);
+    input_ptr = &input;
+
+    // Reports of changes written here are dropped
+    ostream dropped_output(nullptr);
+
+    // Table of command functions indexed by their two letters
+    const Command_table commands = {{"fr", fr_command},
         {"fs", fs_command},
         {"pr", pr_command},
         {"pc", pc_command},
         {"pL", pL_command},
         {"pC", pC_command},
         {"pa", pa_command},
+        {"ps", ps_command},
         {"lr", lr_command},
+        {"lt", lt_command},
+        {"lb", lb_command},
         {"cs", cs_command},
         {"cc", cc_command},
+        {"ci", ci_command},
+        {"cd", cd_command},
+        {"cu", cu_command},
         {"ar", ar_command},
         {"ac", ac_command},
         {"am", am_command},
@@ -131,56 +325,140 @@ int main()
         {"cA", cA_command},
         {"sA", sA_command},
         {"rA", rA_command},
+        {"iL", iL_command},
         {"qq", qq_command}};
 
-    // std::set of Record pointers arranged
-    // by an alphabetical order
-    Lib_ti_t lib_ti;
+    Command_stats command_stats(commands);
+    command_stats_ptr = &command_stats;
 
-    // std::set of Record pointers arranged
-    // by an ascending order of ID
-    Lib_id_t lib_id;
+    // Records indexed by title and by ID
+    Library lib;
 
-    // std::vector of Collections
-    Cat_t cat;
+    // Collections indexed by name
+    Catalog cat;
+
+    // Restore the data recorded in the journal before recording more
+    unique_ptr<Journal> journal;
+    if (!journal_name.empty()) {
+        try {
+            journal = make_unique<Journal>(journal_name);
+            replay_changes(journal->recover(lib, cat), commands, lib, cat);
+        } catch (Error& e) {
+            cerr << e.msg << '\n';
+            return 1;
+        }
+        // A transaction's changes go into one checkpoint when it ends
+        if (!is_transaction)
+            journal_ptr = journal.get();
+    }
+
+    // Started after the journal is recovered, which a failed transaction
+    // goes back to
+    Batch batch;
+    if (!script_name.empty()) {
+        batch.is_transaction = is_transaction;
+        batch_ptr = &batch;
+        report_ptr = &dropped_output;
+    }
+
+    // Serve clients until the server is stopped
+    if (!socket_path.empty()) {
+        try {
+            lib.publish();
+            Socket_server server(socket_path);
+            cout << "Listening on " << socket_path << '\n';
+            output.end_command();
+            server.run([&](int client_fd) { run_session(client_fd, commands, lib, cat); });
+        } catch (Error& e) {
+            cerr << e.msg << '\n';
+            return 1;
+        }
+        return 0;
+    }
+
+    // Declared after the Library and Catalog, so a save still running at
+    // the end is waited for before they go away
+    Background_save background_save;
+    if (save_in_background)
+        background_save_ptr = &background_save;
 
     char first_char, second_char;
-    int record_id = 1;
 
     while (true) {
-        cout << "\nEnter command: ";
-        cin >> first_char >> second_char;
+        // Changes are synced in groups, but always before waiting for input
+        if (journal_ptr != nullptr) {
+            try {
+                journal_ptr->end_command(input.has_buffered_input());
+                if (journal_ptr->is_checkpoint_due())
+                    journal_ptr->checkpoint(lib, cat);
+            } catch (Error& e) {
+                cout << e.msg << '\n';
+            }
+        }
+
+        // Report on a save running in the background
+        if (background_save_ptr != nullptr) {
+            string report = background_save_ptr->check();
+            if (!report.empty())
+                cout << report << '\n';
+        }
+
+        // A batch runs without prompts
+        if (batch_ptr == nullptr)
+            cout << "\nEnter command: ";
+        output.end_command();
 
-        // Construct a command from the two chars
-        string command;
-        command.push_back(first_char);
-        command.push_back(second_char);
+        // The input ended without a qq command
+        if (!input.read_char(first_char) || !input.read_char(second_char))
+            return end_batch(commands, journal.get(), lib, cat);
 
+        const Command_table::Command* command = commands.find(first_char, second_char);
+        int command_index = commands.find_index(first_char, second_char);
+        if (batch_ptr != nullptr)
+            ++batch_ptr->num_commands;
         try {
-            command_map.at(command)(lib_ti, lib_id, cat, record_id);
-            if (command == "qq")
-                return 0;
+            // Queued Records are added before any other command runs, and
+            // a transaction ends if one of them fails
+            if (first_char != 'a' || second_char != 'r') {
+                add_queued_records(lib);
+                if (is_transaction_failed())
+                    return end_batch(commands, journal.get(), lib, cat);
+            }
+            if (command == nullptr) {
+                command_stats.record_unrecognized();
+                throw Error("Unrecognized command!");
+            }
+            if (first_char == 'q' && second_char == 'q') {
+                int status = end_batch(commands, journal.get(), lib, cat);
+                (*command)(lib, cat);
+                return status;
+            }
+            // With no other thread reading, the Library publishes its
+            // changes only when a command is about to read them
+            if (is_lock_free_command(first_char, second_char))
+                lib.publish();
+            run_command(*command, command_index, lib, cat);
         }
-        // Skip rest of the line for Errors
+        // Skip rest of the line for Errors, including unknown commands
         catch (Error& e) {
             skip_rest_of_line(e.msg);
         }
-        // When the command does not exist
-        catch (out_of_range&) {
-            skip_rest_of_line("Unrecognized command!");
-        }
         // Do not skip line for title errors
         catch (Title_error& e) {
-            cout << e.msg << endl;
+            report_error(e.msg);
         }
         // Clear data and exit for other exceptions
         catch (bad_alloc&) {
-            print_and_clear_data("Memory allocation failure!", lib_ti, lib_id, cat, record_id);
+            print_and_clear_data("Memory allocation failure!", lib, cat);
             return 0;
         } catch (...) {
-            print_and_clear_data("Unknown exception caught!", lib_ti, lib_id, cat, record_id);
+            print_and_clear_data("Unknown exception caught!", lib, cat);
             return 0;
         }
+
+        // A transaction ends at its first failure
+        if (is_transaction_failed())
+            return end_batch(commands, journal.get(), lib, cat);
     }
 }
 
@@ -188,703 +466,974 @@ int main()
 
 // Find a Record in the library by reading in the title. When the read-in title
 // is invalid or not found, throw a Title_error
-void fr_command(const Lib_ti_t& lib_ti, const Lib_id_t&, const Cat_t&, const int&)
+void fr_command(const Library& lib, const Catalog&)
 {
-    cout << *find_record_iter(lib_ti);
+    *output_ptr << *find_record_by_title(lib);
 }
 
-// Custom function object class for fs_command's for_each
-class Find_string
-{
-public:
-    Find_string()
-        : at_least_one(false)
-    { }
-    void operator()(const Record* record, const string& str_to_find)
-    {
-        // Create a copy of the record's title and use transform with
-        // tolower to turn it into all lower case
-        string temp = record->get_title();
-        transform(temp.cbegin(), temp.cend(), temp.begin(), ::tolower);
-
-        // If str_to_find is found within the copy, print the Record's
-        // information and set at_least_one to true to indicate that
-        // there is at least one matching Record.
-        if (temp.find(str_to_find) != string::npos) {
-            cout << *record;
-            at_least_one = true;
-        }
-    }
-    // Getter function for at_least_one
-    bool is_at_least_one()
-    {
-        return at_least_one;
-    }
-
-private:
-    bool at_least_one;
-};
-
 // Find and print a set of Records that contain a certain string
 // The match is case-insensitive. Throw an Error if there is no
 // matching Record
-void fs_command(const Lib_ti_t& lib_ti, const Lib_id_t&, const Cat_t&, const int&)
+void fs_command(const Library& lib, const Catalog&)
 {
     // Read in a string and turn it into all lower case
-    string str_to_find;
-    cin >> str_to_find;
+    string str_to_find(read_word());
 
     transform(str_to_find.cbegin(), str_to_find.cend(), str_to_find.begin(), ::tolower);
 
-    // Find_string functor finds Records that contain str_to_find
-    // It sets is_at_least_one boolean to true if there is at least
-    // one matching Record
-    Find_string func;
-    for_each(lib_ti.cbegin(), lib_ti.cend(), bind(ref(func), _1, str_to_find));
+    // The library's search index finds the matching Records in an
+    // alphabetical order. The index is not part of the published
+    // version, so in the server fs runs under the data lock like the
+    // other find commands.
+    vector<Record_entry> found;
+    for (const Record* record_ptr : lib.find_containing(str_to_find))
+        found.push_back(make_entry(record_ptr));
 
     // No matching record existss
-    if (!func.is_at_least_one())
+    if (found.empty())
         throw Error("No records contain that string!");
+
+    vector<const Record_entry*> to_print;
+    to_print.reserve(found.size());
+    for (const Record_entry& entry : found)
+        to_print.push_back(&entry);
+    print_entries(to_print);
 }
 
 // Print a Record's information after reading in a Record's
 // ID. When the ID is invalid or not found in the library,
 // throw an Error
-void pr_command(const Lib_ti_t&, const Lib_id_t& lib_id, const Cat_t&, const int&)
+void pr_command(const Library& lib, const Catalog&)
 {
-    cout << *find_record_iter(lib_id);
+    *output_ptr << *find_record_ptr(lib);
 }
 
 // Find a Collection by reading in its name and print its
 // information. When the read-in Collection is not found in
 // the catalog, throw an Error
-void pc_command(const Lib_ti_t&, const Lib_id_t&, const Cat_t& cat, const int&)
+void pc_command(const Library& lib, const Catalog& cat)
 {
-    cout << find_const_collection(cat);
+    find_const_collection(cat).print(*output_ptr, lib);
 }
 
-// Print the library's entire set of Records
-void pL_command(const Lib_ti_t& lib_ti, const Lib_id_t&, const Cat_t&, const int&)
+// Print the library's entire set of Records, from the published version
+void pL_command(const Library& lib, const Catalog&)
 {
-    if (lib_ti.empty()) {
-        cout << "Library is empty" << endl;
+    Epoch_guard guard;
+    const Library_version& version = lib.get_version();
+    if (version.size == 0) {
+        *output_ptr << "Library is empty\n";
         return;
     }
 
-    cout << "Library contains " << lib_ti.size() << " records:" << endl;
+    *output_ptr << "Library contains " << version.size << " records:\n";
 
     // Print each Record's information
-    ostream_iterator<Record*> out_it(cout);
-    copy(lib_ti.cbegin(), lib_ti.cend(), out_it);
+    vector<const Record_entry*> entries;
+    entries.reserve(version.size);
+    version.for_each_by_title([&entries](const Record_entry& entry) { entries.push_back(&entry); });
+    print_entries(entries);
 }
 
 // Print the catalog's entire set of Collections and their members
-void pC_command(const Lib_ti_t&, const Lib_id_t&, const Cat_t& cat, const int&)
+void pC_command(const Library& lib, const Catalog& cat)
 {
     if (cat.empty()) {
-        cout << "Catalog is empty" << endl;
+        *output_ptr << "Catalog is empty\n";
         return;
     }
 
-    cout << "Catalog contains " << cat.size() << " collections:" << endl;
+    *output_ptr << "Catalog contains " << cat.size() << " collections:\n";
 
     // Print each Collection's information
-    ostream_iterator<Collection> out_it(cout);
-    copy(cat.cbegin(), cat.cend(), out_it);
+    for_each(cat.cbegin(), cat.cend(), [&](const Collection& collection) { collection.print(*output_ptr, lib); });
 }
 
-// Print the number of Records and Collections
-void pa_command(const Lib_ti_t& lib_ti, const Lib_id_t&, const Cat_t& cat, const int&)
+// Print the number of Records and Collections, and the bytes of memory
+// in use in each category, with their peaks if those are tracked
+void pa_command(const Library& lib, const Catalog& cat)
 {
-    cout << "Memory allocations:" << endl;
-    cout << "Records: " << lib_ti.size() << endl;
-    cout << "Collections: " << cat.size() << endl;
+    *output_ptr << "Memory allocations:\n";
+    *output_ptr << "Records: " << lib.size() << '\n';
+    *output_ptr << "Record arena: " << lib.get_arena_bytes_reserved() << " bytes reserved, " << lib.get_arena_bytes_used()
+         << " bytes used\n";
+    *output_ptr << "Collections: " << cat.size() << '\n';
+
+    bool show_peaks = memory_peaks_tracked();
+    *output_ptr << "Memory used: " << total_memory_in_use() << " bytes";
+    if (show_peaks)
+        *output_ptr << ", peak " << total_memory_peak() << " bytes";
+    *output_ptr << '\n';
+    for (int index = 0; index < num_memory_categories; ++index) {
+        Memory_category category = static_cast<Memory_category>(index);
+        *output_ptr << "  " << memory_category_name(category) << ": " << memory_in_use(category) << " bytes";
+        if (show_peaks)
+            *output_ptr << ", peak " << memory_peak(category) << " bytes";
+        *output_ptr << '\n';
+    }
+
+    // A Record costs its share of everything but the collections
+    size_t collection_bytes = memory_in_use(Memory_category::members) + memory_in_use(Memory_category::catalog);
+    if (lib.size() > 0)
+        *output_ptr << "Bytes per record: " << (total_memory_in_use() - collection_bytes) / lib.size() << '\n';
+    long num_memberships = 0;
+    for (const Collection& collection : cat)
+        num_memberships += collection.size();
+    if (num_memberships > 0)
+        *output_ptr << "Bytes per membership: " << memory_in_use(Memory_category::members) / num_memberships << '\n';
 }
 
-// Functor used for lr_command. It returns the order of rating
-// in a descending order. When the ratings are equal return the
-// order of titles in an alphabetical order
-struct Rating_compare
+// Print how many times each command has run, how many of those ended in
+// an error, and how long they took, then start counting again
+void ps_command(Library&, Catalog&)
 {
-    bool operator()(const Record* r1, const Record* r2)
-    {
-        if (r1->get_rating() == r2->get_rating())
-            return r1->get_title() < r2->get_title();
-        return r1->get_rating() > r2->get_rating();
-    }
-};
+    command_stats_ptr->print_and_reset(*output_ptr);
+}
 
 // Output the contents of the library in a descending order of rating.
 // Records with the same rating appear in an alphabetical order by title.
 // If the library is empty, simply print a message indicating it is empty.
-void lr_command(const Lib_ti_t& lib_ti, const Lib_id_t&, const Cat_t&, const int&)
+void lr_command(const Library& lib, const Catalog&)
 {
-    if (lib_ti.empty()) {
-        cout << "Library is empty" << endl;
+    Epoch_guard guard;
+    const Library_version& version = lib.get_version();
+    if (version.size == 0) {
+        *output_ptr << "Library is empty\n";
         return;
     }
 
-    // Create a temporary set that orders Records in a descending order
-    // of Records; when titles are equal they are ordered in an
-    // alphabetical order. Then copy the library's Records to the temp set.
-    set<Record*, Rating_compare> temp;
-    for_each(lib_ti.cbegin(), lib_ti.cend(), [&](Record* record) { temp.insert(record); });
-
-    // Print temp set's Records
-    ostream_iterator<Record*> out_it(cout);
-    copy(temp.cbegin(), temp.cend(), out_it);
+    // The published version keeps each rating's Records in title order
+    vector<const Record_entry*> entries;
+    entries.reserve(version.size);
+    for (int rating = 5; rating >= 0; --rating) {
+        for (const Record_entry& entry : version.by_rating[rating])
+            entries.push_back(&entry);
+    }
+    print_entries(entries);
 }
 
-// Custom function object class used for cs_command's for_each.
-class Collection_stats
+// Output the given number of highest rated Records, in the same order
+// as lr_command. Throw an Error if the number is not positive.
+void lt_command(const Library& lib, const Catalog&)
 {
-public:
-    Collection_stats()
-        : first_time(true)
-        , total_member(0)
-        , total_at_least_one(0)
-        , total_more_than_one(0)
-    { }
-
-    // Loop through every Collection in catalog to find the
-    // number of Collections in which the Record exists.
-    void operator()(Record* record, const Cat_t& cat)
-    {
-        // exists_in_collection keeps track of the number
-        // of Collections in which the Record exists
-        int exists_in_collection = 0;
-
-        // the one range for
-        for (const Collection& col : cat) {
-            // first_time ensures that total_member
-            // only counts the total members in the first
-            // set of iterations of this for loop
-            if (first_time)
-                total_member += col.size();
-
-            if (col.is_member_present(record))
-                ++exists_in_collection;
-        }
-        first_time = false;
-        if (exists_in_collection > 0)
-            ++total_at_least_one;
-
-        if (exists_in_collection > 1)
-            ++total_more_than_one;
-    }
-    // Getter functions for private members
-    int get_total_member()
-    {
-        return total_member;
+    int count = read_and_check_integer(*input_ptr);
+    if (count < 1)
+        throw Error("Number of Records is out of range!");
+
+    Epoch_guard guard;
+    const Library_version& version = lib.get_version();
+    if (version.size == 0) {
+        *output_ptr << "Library is empty\n";
+        return;
     }
-    int get_total_at_least_one()
-    {
-        return total_at_least_one;
+
+    ostream_iterator<Record_entry> out_it(*output_ptr);
+    for (int rating = 5; rating >= 0 && count > 0; --rating) {
+        const Entry_tree& tree = version.by_rating[rating];
+        for (auto iter = tree.begin(); count > 0 && iter != tree.end(); --count, ++iter)
+            *out_it = *iter;
     }
-    int get_total_more_than_one()
-    {
-        return total_more_than_one;
+}
+
+// Output the Records rated between the two ratings inclusive, in the
+// same order as lr_command. Unrated Records have a rating of 0. Throw an
+// Error if a rating is not between 0 and 5 or the range is empty.
+void lb_command(const Library& lib, const Catalog&)
+{
+    int low = read_and_check_integer(*input_ptr);
+    int high = read_and_check_integer(*input_ptr);
+    if (low < 0 || high > 5 || low > high)
+        throw Error("Rating is out of range!");
+
+    Epoch_guard guard;
+    const Library_version& version = lib.get_version();
+    bool is_empty = true;
+    for (int rating = low; rating <= high; ++rating)
+        is_empty = is_empty && version.by_rating[rating].size() == 0;
+    if (is_empty) {
+        *output_ptr << "No Records rated " << low << " to " << high << '\n';
+        return;
     }
 
-private:
-    bool first_time;
-    int total_member;
-    int total_at_least_one;
-    int total_more_than_one;
-};
+    vector<const Record_entry*> entries;
+    for (int rating = high; rating >= low; --rating) {
+        for (const Record_entry& entry : version.by_rating[rating])
+            entries.push_back(&entry);
+    }
+    print_entries(entries);
+}
 
-// Iterate through all Collections to see how many Records exist in
-// at least one Collection and in more than one Collection. Also count
-// the total number of members in all Collections.
-void cs_command(const Lib_ti_t& lib_ti, const Lib_id_t&, const Cat_t& cat, const int&)
+// Report how many Records exist in at least one Collection and in more
+// than one Collection, and the total number of members in all Collections.
+// The Library keeps these counts up to date as members come and go, and
+// they are read from its published version.
+void cs_command(const Library& lib, const Catalog&)
 {
-    Collection_stats func;
-    for_each(lib_ti.cbegin(), lib_ti.cend(), bind(ref(func), _1, cat));
-
-    cout << func.get_total_at_least_one() << " out of " << lib_ti.size() << " Records appear in at least one Collection"
-         << endl;
+    Epoch_guard guard;
+    const Library_version& version = lib.get_version();
+    *output_ptr << version.num_in_at_least_one << " out of " << version.size
+         << " Records appear in at least one Collection" << '\n';
 
-    cout << func.get_total_more_than_one() << " out of " << lib_ti.size()
-         << " Records appear in more than one Collection" << endl;
+    *output_ptr << version.num_in_more_than_one << " out of " << version.size
+         << " Records appear in more than one Collection" << '\n';
 
-    cout << "Collections contain a total of " << func.get_total_member() << " Records" << endl;
+    *output_ptr << "Collections contain a total of " << version.total_memberships << " Records\n";
 }
 
 // Find two Collections from the catalog and combine them to
 // create a new Collection. Throw an Error if any of the two
 // Collection is not found, and if the new Collection's name
 // already exists in the catalog.
-void cc_command(const Lib_ti_t&, const Lib_id_t&, Cat_t& cat, const int&)
+void cc_command(Library& lib, Catalog& cat)
 {
     const Collection& col_first = find_collection_ref(cat);
     const Collection& col_second = find_collection_ref(cat);
 
-    string name;
-    cin >> name;
+    string name(read_word());
 
-    Cat_citer insert_here = find_and_check_if_already_present(cat, name);
+    check_if_already_present(cat, name);
 
-    cout << "Collections " << col_first.get_name() << " and " << col_second.get_name()
-         << " combined into new collection " << name << endl;
+    *report_ptr << "Collections " << col_first.get_name() << " and " << col_second.get_name()
+         << " combined into new collection " << name << '\n';
 
     // Create a new Collection from the two Collections and add it to the catalog
-    cat.emplace(insert_here, Collection(col_first, col_second, name));
+    cat.add(Collection(col_first, col_second, name, lib), lib);
+    journal_change("cc " + col_first.get_name() + " " + col_second.get_name() + " " + name);
+}
+
+// Find two Collections from the catalog and create a new Collection of
+// the Records that are in both. Throw an Error if any of the two
+// Collection is not found, and if the new Collection's name
+// already exists in the catalog.
+void ci_command(Library& lib, Catalog& cat)
+{
+    const Collection& col_first = find_collection_ref(cat);
+    const Collection& col_second = find_collection_ref(cat);
+
+    string name(read_word());
+
+    check_if_already_present(cat, name);
+
+    Collection* new_col = cat.add(Collection::intersect(col_first, col_second, name, lib), lib);
+    journal_change("ci " + col_first.get_name() + " " + col_second.get_name() + " " + name);
+    *report_ptr << "Collections " << col_first.get_name() << " and " << col_second.get_name()
+         << " intersected into new collection " << name << " with " << new_col->size() << " members\n";
+}
+
+// Find two Collections from the catalog and create a new Collection of
+// the Records that are in the first but not the second. Throw an Error
+// if any of the two Collection is not found, and if the new Collection's
+// name already exists in the catalog.
+void cd_command(Library& lib, Catalog& cat)
+{
+    const Collection& col_first = find_collection_ref(cat);
+    const Collection& col_second = find_collection_ref(cat);
+
+    string name(read_word());
+
+    check_if_already_present(cat, name);
+
+    Collection* new_col = cat.add(Collection::subtract(col_first, col_second, name, lib), lib);
+    journal_change("cd " + col_first.get_name() + " " + col_second.get_name() + " " + name);
+    *report_ptr << "Collection " << col_second.get_name() << " subtracted from " << col_first.get_name()
+         << " into new collection " << name << " with " << new_col->size() << " members\n";
+}
+
+// Read a number of Collections, find each of them in the catalog, and
+// combine them all to create a new Collection. Throw an Error if the
+// number is less than 1, if a Collection is not found, and if the new
+// Collection's name already exists in the catalog.
+void cu_command(Library& lib, Catalog& cat)
+{
+    int num_collection = read_and_check_integer(*input_ptr);
+    if (num_collection < 1)
+        throw Error("Number of collections is out of range!");
+
+    vector<const Collection*> collections;
+    for (int i = 0; i < num_collection; ++i)
+        collections.push_back(&find_collection_ref(cat));
+
+    string name(read_word());
+
+    check_if_already_present(cat, name);
+
+    Collection* new_col = cat.add(Collection::combine_all(collections, name, lib), lib);
+
+    string change = "cu " + to_string(num_collection);
+    for (const Collection* col : collections)
+        change += " " + col->get_name();
+    journal_change(change + " " + name);
+
+    *report_ptr << num_collection << " collections combined into new collection " << name << " with " << new_col->size()
+         << " members\n";
 }
 
 // Create a Record by reading in its medium and title. When the title
 // is invalid, or the library has the Record with the same title already,
-// throw a Title_error
-void ar_command(Lib_ti_t& lib_ti, Lib_id_t& lib_id, const Cat_t&, int& record_id)
+// throw a Title_error. In a batch the Record is queued instead.
+void ar_command(Library& lib, const Catalog&)
 {
-    string medium;
-    cin >> medium;
+    // The medium is copied, since reading the title moves on in the input
+    string medium(read_word());
 
-    string title = read_title();
-
-    // Create a Record with the given medium and string but throw an Error
-    // if the Record already exists in the library.
-    // Initialize record_ptr here to be able to delete the pointer
-    // when an exception is thrown.
-    // Set record_ptr to nullptr initially to avoid compiler errors.
-    Record* new_record = nullptr;
+    string_view title;
     try {
-        new_record = new Record(record_id, medium, title);
-    } catch (...) {
-        delete new_record;
+        title = read_title();
+    } catch (Title_error&) {
+        // The queued Records come first, so the errors stay in order
+        add_queued_records(lib);
         throw;
     }
 
-    if (!lib_ti.insert(new_record).second) {
-        delete new_record;
-        throw Title_error("Library already has a record with this title!");
+    if (batch_ptr != nullptr) {
+        queue_record(lib, medium, title);
+        return;
     }
-    lib_id.insert(new_record);
 
-    cout << "Record " << record_id++ << " added" << endl;
+    // Create a Record with the given medium and string but throw an Error
+    // if the Record already exists in the library.
+    Record* new_record = lib.add_record(medium, title);
+    if (new_record == nullptr)
+        throw Title_error("Library already has a record with this title!");
+
+    *report_ptr << "Record " << new_record->get_ID() << " added\n";
+    journal_change("ar " + medium + " " + string(title));
 }
 
 // Add a Collection by reading in a name. When the catalog already
 // has a Collection with the same name, throw an Error
-void ac_command(const Lib_ti_t&, const Lib_id_t&, Cat_t& cat, const int&)
+void ac_command(const Library&, Catalog& cat)
 {
-    string name;
-    cin >> name;
+    string name(read_word());
 
     // Search the catalog and throw an Error if the Collection
     // already exists.
-    Cat_citer insert_here = find_and_check_if_already_present(cat, name);
+    check_if_already_present(cat, name);
 
     // Create a new Collection with the given name and
     // add it to the catalog.
-    cat.emplace(insert_here, Collection(name));
-    cout << "Collection " << name << " added" << endl;
+    cat.add(name);
+    *report_ptr << "Collection " << name << " added\n";
+    journal_change("ac " + name);
 }
 
 // Add a member to a Collection. When the read-in Collection does not
 // exist, the read-in Record's ID does not exist, or the Record is already
 // a member of the Collection, throw an Error
-void am_command(const Lib_ti_t&, const Lib_id_t& lib_id, Cat_t& cat, const int&)
+void am_command(Library& lib, Catalog& cat)
 {
     Collection& col = find_collection_ref(cat);
 
-    Record* record_ptr = *find_record_iter(lib_id);
-    col.add_member(record_ptr);
+    Record* record_ptr = find_record_ptr(lib);
+    col.add_member(record_ptr, lib);
 
-    cout << "Member " << record_ptr->get_ID() << " " << record_ptr->get_title() << " added" << endl;
+    *report_ptr << "Member " << record_ptr->get_ID() << " " << record_ptr->get_title() << " added\n";
+    journal_change("am " + col.get_name() + " " + to_string(record_ptr->get_ID()));
 }
 
 // Modify a Record's rating by reading in an ID and the desired rating
 // When the ID or rating is invalid, or ID does not exist, throw an Error
-void mr_command(const Lib_ti_t&, const Lib_id_t& lib_id, const Cat_t&, const int&)
+void mr_command(Library& lib, const Catalog&)
 {
-    Record* record_ptr = *find_record_iter(lib_id);
+    Record* record_ptr = find_record_ptr(lib);
 
-    // read_and_set_rating() reads a rating and sets the record's rating
-    // to a new value.
-    record_ptr->read_and_set_rating();
-    cout << "Rating for record " << record_ptr->get_ID() << " changed to " << record_ptr->get_rating() << endl;
+    // The Library moves the Record to its new place in rating order
+    lib.set_rating(record_ptr, read_rating(*input_ptr));
+    *report_ptr << "Rating for record " << record_ptr->get_ID() << " changed to " << record_ptr->get_rating() << '\n';
+    journal_change("mr " + to_string(record_ptr->get_ID()) + " " + to_string(record_ptr->get_rating()));
 }
 
 // Modify a Record's title. Throw an Error if an integer is not read,
 // could not read a title, or there is already a Record with the title.
-void mt_command(Lib_ti_t& lib_ti, Lib_id_t& lib_id, Cat_t& cat, const int&)
+void mt_command(Library& lib, const Catalog&)
 {
-    Lib_id_iter record_iter_found = find_record_iter(lib_id);
-    string title = read_title();
-
-    // .first contains the iterator and .second contains a boolean
-    // indicating whether the item was found or not.
-    pair<Lib_ti_iter, bool> iter_bool = lib_binary_search(lib_ti, title);
+    Record* record_found = find_record_ptr(lib);
+    string_view title = read_title();
 
-    // If the title already exists, throw a Title_error
-    if (iter_bool.second)
+    // If the title already exists, throw a Title_error. Collections
+    // hold their members by ID, so they are not affected.
+    if (!lib.retitle_record(record_found, title))
         throw Title_error("Library already has a record with this title!");
 
-    // If the title does not exist, delete the Record in the library(set)
-    // and create a new Record with the same property except for the
-    // new title and then insert it into the library.
-    else {
-        // Create a new Record with the new title and insert.
-        // Initialize record_ptr here to be able to delete the pointer
-        // when an exception is thrown.
-        // Set record_ptr to nullptr initially to avoid compiler errors.
-        Record* new_record = nullptr;
-
-        try {
-            new_record = new Record((*record_iter_found)->get_ID(),
-                (*record_iter_found)->get_medium(),
-                title,
-                (*record_iter_found)->get_rating());
-        } catch (...) {
-            delete new_record;
-            throw;
-        }
-
-        // For Collections which have the changed Record's pointer,
-        // remove the outdated Record and insert a new one with
-        // the new title.
-        for_each(cat.begin(), cat.end(), [&](Collection& col) {
-            col.remove_then_add_member(*record_iter_found, new_record);
-        });
-
-        cout << "Title for record " << (*record_iter_found)->get_ID() << " changed to " << title << endl;
-
-        // Save the pointer temporarily and erase the pointer
-        // in the libraries. Then free its memory.
-        Record* temp = *record_iter_found;
-
-        lib_ti.erase(lib_ti.find(*record_iter_found));
-        lib_id.erase(record_iter_found);
-        delete temp;
-
-        lib_ti.insert(iter_bool.first, new_record);
-        lib_id.insert(new_record);
-    }
+    *report_ptr << "Title for record " << record_found->get_ID() << " changed to " << title << '\n';
+    journal_change("mt " + to_string(record_found->get_ID()) + " " + string(title));
 }
 
 // Delete a Record in the library by reading in a title and finding it in
 // the library When the title is invalid, the title does not exist, or
 // the Record is a member of a Collection, throw a Title_error
-void dr_command(Lib_ti_t& lib_ti, Lib_id_t& lib_id, const Cat_t& cat, const int&)
+void dr_command(Library& lib, const Catalog&)
 {
-    Lib_ti_iter record_iter = find_record_iter(lib_ti);
+    Record* record_ptr = find_record_by_title(lib);
 
-    // If any Collection is not empty, throw a Title_error
-    if (any_of(cat.cbegin(), cat.cend(), [&](const Collection& col) { return col.is_member_present(*record_iter); }))
+    // If the Record belongs to any Collection, throw a Title_error
+    if (record_ptr->get_num_collections() > 0)
         throw Title_error("Cannot delete a record that is a member of a collection!");
 
-    cout << "Record " << (*record_iter)->get_ID() << " " << (*record_iter)->get_title() << " deleted" << endl;
+    *report_ptr << "Record " << record_ptr->get_ID() << " " << record_ptr->get_title() << " deleted\n";
+    journal_change("dr " + string(record_ptr->get_title()));
 
-    Record* temp = *record_iter;
-    lib_id.erase(lib_id.find(*record_iter));
-    lib_ti.erase(record_iter);
-    delete temp;
+    lib.remove_record(record_ptr);
 }
 
 // Delete a Collection in the catalog by reading in a name. When
 // the Collection does not exist, throw an Error
-void dc_command(const Lib_ti_t&, const Lib_id_t&, Cat_t& cat, const int&)
+void dc_command(Library& lib, Catalog& cat)
 {
-    Cat_citer col_iter = find_collection_iter(cat);
-    cout << "Collection " << col_iter->get_name() << " deleted" << endl;
-    cat.erase(col_iter);
+    Collection& col = find_collection_ref(cat);
+    *report_ptr << "Collection " << col.get_name() << " deleted\n";
+    journal_change("dc " + col.get_name());
+
+    // The Catalog releases the memberships as the Collection goes away
+    cat.remove(col, lib);
 }
 
 // Delete a member of a Collection by reading in a name and a Record's ID.
 // When the read-in Collection does not exist, or the Record is not a member
 // of the Collection, throw an Error
-void dm_command(const Lib_ti_t&, const Lib_id_t& lib_id, Cat_t& cat, const int&)
+void dm_command(Library& lib, Catalog& cat)
 {
     Collection& col = find_collection_ref(cat);
-    Record* record_ptr = *find_record_iter(lib_id);
+    Record* record_ptr = find_record_ptr(lib);
 
-    col.remove_member(record_ptr);
-    cout << "Member " << record_ptr->get_ID() << " " << record_ptr->get_title() << " deleted" << endl;
+    col.remove_member(record_ptr, lib);
+    *report_ptr << "Member " << record_ptr->get_ID() << " " << record_ptr->get_title() << " deleted\n";
+    journal_change("dm " + col.get_name() + " " + to_string(record_ptr->get_ID()));
 }
 
 // Function wrappers for cL and cC commands
-void cL_command_wrapper(Lib_ti_t& lib_ti, Lib_id_t& lib_id, const Cat_t& cat, int& record_id)
+void cL_command_wrapper(Library& lib, const Catalog& cat)
 {
-    cL_command(lib_ti, lib_id, cat, record_id);
-    cout << "All records deleted" << endl;
+    cL_command(lib, cat);
+    *report_ptr << "All records deleted\n";
+    journal_change("cL");
 }
 
-void cC_command_wrapper(const Lib_ti_t& lib_ti, const Lib_id_t& lib_id, Cat_t& cat, const int& record_id)
+void cC_command_wrapper(Library& lib, Catalog& cat)
 {
-    cC_command(lib_ti, lib_id, cat, record_id);
-    cout << "All collections deleted" << endl;
+    cC_command(lib, cat);
+    *report_ptr << "All collections deleted\n";
+    journal_change("cC");
 }
 
 // Remove all Records from the library. When at least one Record is
 // present in the catalog, throw an Error
-void cL_command(Lib_ti_t& lib_ti, Lib_id_t& lib_id, const Cat_t& cat, int& record_id)
+void cL_command(Library& lib, const Catalog&)
 {
     // If any Collection is not empty, throw an Error
-    if (any_of(cat.cbegin(), cat.cend(), [](Collection col) { return !col.empty(); }))
+    if (lib.get_total_memberships() > 0)
         throw Error("Cannot clear all records unless all collections are empty!");
 
-    // Delete all Records
-    for_each(lib_id.cbegin(), lib_id.cend(), [](Record* record) { delete record; });
-    lib_ti.clear();
-    lib_id.clear();
-    record_id = 1;
+    // Delete all Records, and publish at once so that the arena is
+    // reclaimed now rather than at the next read
+    lib.clear();
+    lib.publish();
 }
 
 // Remove all Collections from the catalog
-void cC_command(const Lib_ti_t&, const Lib_id_t&, Cat_t& cat, const int&)
+void cC_command(Library& lib, Catalog& cat)
 {
-    cat.clear();
+    cat.clear(lib);
 }
 
 // Remove all Collections from the catalog and all Records from the library
-void cA_command(Lib_ti_t& lib_ti, Lib_id_t& lib_id, Cat_t& cat, int& record_id)
+void cA_command(Library& lib, Catalog& cat)
+{
+    cC_command(lib, cat);
+    cL_command(lib, cat);
+    *report_ptr << "All data deleted\n";
+    journal_change("cA");
+}
+
+// Save the current library and catalog to a file. A file name ending in
+// ".bin" selects the binary snapshot format, any other name the text
+// format. The file is written under a temporary name and renamed into
+// place. In the background save mode the save only starts here, and is
+// reported on at the following prompts. When the file cannot be opened
+// for writing, or another save is still running, throw an Error
+void sA_command(const Library& lib, const Catalog& cat)
+{
+    string file_name(read_word());
+
+    if (background_save_ptr != nullptr) {
+        background_save_ptr->start(file_name, lib, cat);
+        *output_ptr << "Saving data in the background\n";
+        return;
+    }
+
+    save_snapshot(file_name, lib, cat);
+    *output_ptr << "Data saved\n";
+}
+
+// Load a set of Records and Collections and their members, and set
+// the Record ID to the highest ID + 1 of the load file. A file name
+// ending in ".bin" is read as a binary snapshot, any other name as text.
+// Report how many Records were loaded and how fast.
+// When the file cannot be opened, ends early, or has a negative or
+// invalid number, throw an error and roll back the library and the
+// catalog to the original state so that they do not lose any data.
+void rA_command(Library& lib, Catalog& cat)
 {
-    cC_command(lib_ti, lib_id, cat, record_id);
-    cL_command(lib_ti, lib_id, cat, record_id);
-    cout << "All data deleted" << endl;
+    string file_name(read_word());
+
+    // Create backup containers
+    Catalog cat_backup(move(cat));
+    Library lib_backup(move(lib));
+
+    auto start = chrono::steady_clock::now();
+    try {
+        if (is_binary_snapshot(file_name))
+            restore_binary_snapshot(file_name, lib, cat);
+        else
+            restore_text_snapshot(file_name, lib, cat);
+    } catch (Error& e) {
+        // Rollback to the backups. The Records read from the file are
+        // deleted along with the backup library, once readers are back on
+        // the original data.
+        cat.swap(cat_backup);
+        lib.swap(lib_backup);
+        lib.publish();
+        throw e;
+    }
+    chrono::duration<double> seconds = chrono::steady_clock::now() - start;
+
+    // Readers move to the loaded data before the backup, whose Records
+    // they saw until now, is deleted and reclaimed
+    lib.publish();
+
+    // A load too quick to time is reported at the rate of one microsecond
+    double records_per_second = lib.size() / max(seconds.count(), 1e-6);
+    *output_ptr << "Data loaded: " << lib.size() << " records, " << static_cast<long long>(records_per_second)
+         << " records/s\n";
+
+    // The journal starts over from the loaded data
+    journal_checkpoint(lib, cat);
 }
 
-// Save the current library and catalog to a file. When the file cannot be
-// opened for writing, throw an Error
-void sA_command(const Lib_ti_t& lib_ti, const Lib_id_t&, const Cat_t& cat, const int&)
+// Add the Records in a CSV or TSV file to the library, with the next
+// ID numbers in the order of the file. Rows whose title is already in
+// the library, or in an earlier row, are skipped and counted. When the
+// file cannot be opened or has an invalid row, throw an Error; the
+// library is then unchanged.
+void iL_command(Library& lib, const Catalog& cat)
 {
-    ofstream myfile;
-    string file_name;
-    cin >> file_name;
+    string file_name(read_word());
 
-    myfile.open(file_name);
-    if (myfile.is_open()) {
+    // Publish at once, so that what the import replaced is reclaimed now
+    Import_result result = import_records(file_name, lib);
+    lib.publish();
+    *output_ptr << result.num_added << " records imported, " << result.num_duplicate << " duplicate titles skipped\n";
 
-        myfile << lib_ti.size() << endl;
+    // The imported Records go into a checkpoint rather than the journal
+    journal_checkpoint(lib, cat);
+}
 
-        // Save each Record to the specified file first
-        for_each(lib_ti.cbegin(), lib_ti.cend(), [&](Record* record) { record->save(myfile); });
+// Clear the catalog and library
+void qq_command(Library& lib, Catalog& cat)
+{
+    cC_command(lib, cat);
+    cL_command(lib, cat);
+    *output_ptr << "All data deleted\n";
+    *output_ptr << "Done";
+}
 
-        myfile << cat.size() << endl;
+// Helper functions used for main
 
-        // Save each Collection to the file
-        for_each(cat.cbegin(), cat.cend(), [&](Collection collection) { collection.save(myfile); });
+// Print error_msg to the output and skip rest of the line until \n character
+void skip_rest_of_line(const char* error_msg)
+{
+    report_error(error_msg);
+    input_ptr->skip_line();
+}
 
-        myfile.close();
-        cout << "Data saved" << endl;
-    } else
-        throw Error("Could not open file!");
+// Print the message of the command that failed. In a batch, say which
+// command it was.
+void report_error(const char* error_msg)
+{
+    if (batch_ptr != nullptr)
+        report_batch_error(batch_ptr->num_commands, error_msg);
+    else
+        *output_ptr << error_msg << '\n';
 }
 
-// Load a set of Records and Collections and their members, and set
-// the Record ID to the highest ID + 1 of the load file. When the
-// file cannot be opened, throw an Error, but the current library and
-// catalog do not lose their data. When the file ends early, or has
-// a negative or invalid number, throw an error and roll back the
-// library and the catalog to the original state so that they do not
-// lose any data.
-void rA_command(Lib_ti_t& lib_ti, Lib_id_t& lib_id, Cat_t& cat, int& record_id)
-{
-    string file_name;
-    cin >> file_name;
-
-    ifstream myfile(file_name);
-    if (myfile.is_open()) {
-        // Create backup containers
-        Cat_t cat_backup(move(cat));
-        Lib_id_t lib_id_backup(move(lib_id));
-        Lib_ti_t lib_ti_backup(move(lib_ti));
-
-        int record_id_backup = record_id;
-        int biggest_id = 0;
-
-        // Initialize record_ptr here to be able to delete the pointer
-        // when an exception is thrown.
-        // Set record_ptr to nullptr initially to avoid compiler errors.
-        Record* record_ptr = nullptr;
+// Read in the next word of the input. The view is valid until the
+// next read.
+string_view read_word()
+{
+    return input_ptr->read_word();
+}
+
+// Print error_msg and clear all data. The journal stops first, so the
+// data it holds is kept.
+void print_and_clear_data(const char* error_msg, Library& lib, Catalog& cat)
+{
+    journal_ptr = nullptr;
+    cout << error_msg << '\n';
+    cA_command(lib, cat);
+}
+
+// Run the command with the index, counting the run, how it ended and how
+// long it took in the command statistics. Errors are passed on.
+void run_command(const Command_table::Command& command, int index, Library& lib, Catalog& cat)
+{
+    auto start = chrono::steady_clock::now();
+    Command_stats::Outcome outcome = Command_stats::Outcome::done;
+    try {
+        command(lib, cat);
+    } catch (Error&) {
+        outcome = Command_stats::Outcome::error;
+        command_stats_ptr->record(index, outcome, chrono::steady_clock::now() - start);
+        throw;
+    } catch (Title_error&) {
+        outcome = Command_stats::Outcome::title_error;
+        command_stats_ptr->record(index, outcome, chrono::steady_clock::now() - start);
+        throw;
+    }
+    command_stats_ptr->record(index, outcome, chrono::steady_clock::now() - start);
+}
+
+// Helper functions for the journal
+
+// Record a change in the journal, if one is kept
+void journal_change(const string& change)
+{
+    if (journal_ptr != nullptr)
+        journal_ptr->append(change);
+}
+
+// Take a checkpoint of the library and catalog, if a journal is kept
+void journal_checkpoint(const Library& lib, const Catalog& cat)
+{
+    if (journal_ptr != nullptr)
+        journal_ptr->checkpoint(lib, cat);
+}
+
+// Replay the journaled changes with the commands that made them, reading
+// each change as the command's input and discarding the output. Throw an
+// Error if one fails, since it succeeded when it was journaled.
+void replay_changes(const vector<string>& changes, const Command_table& commands, Library& lib, Catalog& cat)
+{
+    Input_reader* command_input = input_ptr;
+    streambuf* output = cout.rdbuf(nullptr);
+
+    bool replayed = true;
+    for (const string& change : changes) {
+        Input_reader change_input(change + '\n');
+        input_ptr = &change_input;
+
+        char first_char = 0, second_char = 0;
+        change_input.read_char(first_char);
+        change_input.read_char(second_char);
+        const Command_table::Command* command = commands.find(first_char, second_char);
         try {
-            int num_record;
-            myfile >> num_record;
-
-            check_stream_state_and_value(myfile, num_record);
-
-            // Load records from the file
-            for (int i = 0; i < num_record; ++i) {
-                record_ptr = new Record(myfile);
-                lib_id.insert(record_ptr);
-                lib_ti.insert(record_ptr);
-                if (record_ptr->get_ID() > biggest_id)
-                    biggest_id = record_ptr->get_ID();
-            }
+            if (command == nullptr)
+                throw Error("Unrecognized command!");
+            (*command)(lib, cat);
+        } catch (Error&) {
+            replayed = false;
+        } catch (Title_error&) {
+            replayed = false;
+        }
+        if (!replayed)
+            break;
+    }
 
-            int num_collection;
-            myfile >> num_collection;
+    // Setting the buffer back also clears the output stream's state
+    input_ptr = command_input;
+    cout.rdbuf(output);
+    if (!replayed)
+        throw Error("Invalid data found in journal!");
+}
 
-            check_stream_state_and_value(myfile, num_collection);
+// Helper functions for the server
 
-            // Load collections from the file
-            for (int j = 0; j < num_collection; ++j) {
-                Collection new_collection(myfile, lib_ti);
-                // Binary search to see where to insert the new Collection
-                pair<Cat_citer, bool> iter_bool = cat_binary_search(cat, new_collection.get_name());
+// Return true if the command reads the Library's published version
+// rather than the data under the lock: pL, the list commands, and cs.
+bool is_lock_free_command(char first_char, char second_char)
+{
+    return (first_char == 'p' && second_char == 'L') || first_char == 'l' || (first_char == 'c' && second_char == 's');
+}
+
+// Return true if the command only reads the Library and Catalog, so that
+// it can run alongside other such commands: the find, print and list
+// commands, and cs.
+bool is_read_only_command(char first_char, char second_char)
+{
+    return first_char == 'f' || first_char == 'p' || first_char == 'l' || (first_char == 'c' && second_char == 's');
+}
+
+// Run a command that changes the data, then publish the Library's new
+// version, whether or not the command succeeded
+void run_change(const Command_table::Command& command, int index, Library& lib, Catalog& cat)
+{
+    try {
+        run_command(command, index, lib, cat);
+    } catch (...) {
+        lib.publish();
+        throw;
+    }
+    lib.publish();
+}
 
-                // First element in the pair indicates where to insert
-                cat.emplace(iter_bool.first, new_collection);
+// Run the commands a client sends, with its replies sent back through
+// the same connection, until it sends qq or closes its end. Commands that
+// only read run alongside each other, and those that read the published
+// version take no lock at all; changes run one at a time. A change
+// is journaled like one typed in, and synced before waiting for the
+// client once it has no more input waiting.
+void run_session(int client_fd, const Command_table& commands, Library& lib, Catalog& cat)
+{
+    Input_reader input(client_fd);
+    Socket_writer writer(client_fd);
+    ostream client_output(&writer);
+    Output_buffer output(client_output);
+    input_ptr = &input;
+    output_ptr = &client_output;
+    report_ptr = &client_output;
+
+    bool has_changed = false;
+    char first_char, second_char;
+    while (true) {
+        if (has_changed && journal_ptr != nullptr) {
+            try {
+                unique_lock<shared_mutex> lock(data_mutex);
+                has_changed = input.has_buffered_input();
+                journal_ptr->end_command(has_changed);
+                if (journal_ptr->is_checkpoint_due())
+                    journal_ptr->checkpoint(lib, cat);
+            } catch (Error& e) {
+                client_output << e.msg << '\n';
             }
+        }
+
+        client_output << "\nEnter command: ";
+        output.end_command();
 
-            // Delete backup Records
-            for_each(lib_id_backup.cbegin(), lib_id_backup.cend(), [](Record* record) { delete record; });
+        if (!input.read_char(first_char) || !input.read_char(second_char))
+            break;
 
-            record_id = ++biggest_id;
-            myfile.close();
-            cout << "Data loaded" << endl;
+        // Ending a session leaves the data for the other clients
+        if (first_char == 'q' && second_char == 'q') {
+            client_output << "Done";
+            break;
+        }
+
+        const Command_table::Command* command = commands.find(first_char, second_char);
+        int command_index = commands.find_index(first_char, second_char);
+        try {
+            if (command == nullptr) {
+                command_stats_ptr->record_unrecognized();
+                throw Error("Unrecognized command!");
+            }
+            if (is_lock_free_command(first_char, second_char)) {
+                run_command(*command, command_index, lib, cat);
+            } else if (is_read_only_command(first_char, second_char)) {
+                shared_lock<shared_mutex> lock(data_mutex);
+                run_command(*command, command_index, lib, cat);
+            } else {
+                unique_lock<shared_mutex> lock(data_mutex);
+                has_changed = true;
+                run_change(*command, command_index, lib, cat);
+            }
         } catch (Error& e) {
-            // Delete Records read from the file
-            for_each(lib_id.cbegin(), lib_id.cend(), [](Record* record) { delete record; });
-
-            // Rollback to the backups
-            cat.swap(cat_backup);
-            lib_id.swap(lib_id_backup);
-            lib_ti.swap(lib_ti_backup);
-            record_id = record_id_backup;
-            myfile.close();
-            throw e;
+            skip_rest_of_line(e.msg);
+        } catch (Title_error& e) {
+            report_error(e.msg);
+        } catch (bad_alloc&) {
+            client_output << "Memory allocation failure!\n";
+            break;
         } catch (...) {
-            delete record_ptr;
-            myfile.close();
-            throw;
+            client_output << "Unknown exception caught!\n";
+            break;
         }
-    } else {
-        myfile.close();
-        throw Error("Could not open file!");
     }
-}
 
-// Clear the catalog and library
-void qq_command(Lib_ti_t& lib_ti, Lib_id_t& lib_id, Cat_t& cat, int& record_id)
-{
-    cC_command(lib_ti, lib_id, cat, record_id);
-    cL_command(lib_ti, lib_id, cat, record_id);
-    cout << "All data deleted\n";
-    cout << "Done";
+    // The client's last changes are synced before it is let go
+    if (has_changed && journal_ptr != nullptr) {
+        try {
+            unique_lock<shared_mutex> lock(data_mutex);
+            journal_ptr->sync();
+        } catch (Error& e) {
+            client_output << e.msg << '\n';
+        }
+    }
 }
 
-// Helper functions used for main
+// Helper functions for batches
 
-// Print error_msg to cout and skip rest of the line until \n character
-void skip_rest_of_line(const char* error_msg)
+// Queue a Record read by an ar command in a batch, adding the queue to
+// the library once it is full
+void queue_record(Library& lib, const string& medium, string_view title)
 {
-    cout << error_msg << endl;
-    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+    string& text = batch_ptr->queued_text;
+    Queued_record queued{batch_ptr->num_commands, text.size(), 0, 0};
+    text += medium;
+    queued.title_begin = text.size();
+    text += title;
+    queued.title_end = text.size();
+    batch_ptr->queued_records.push_back(queued);
+
+    if (batch_ptr->queued_records.size() >= max_queued_records)
+        add_queued_records(lib);
 }
 
-// Print error_msg and clear all data
-void print_and_clear_data(const char* error_msg, Lib_ti_t& lib_ti, Lib_id_t& lib_id, Cat_t& cat, int& record_id)
+// Add the queued Records to the library together, in the order of their
+// commands, and report those whose title was taken as failed
+void add_queued_records(Library& lib)
 {
-    cout << error_msg << endl;
-    cA_command(lib_ti, lib_id, cat, record_id);
+    if (batch_ptr == nullptr || batch_ptr->queued_records.empty())
+        return;
+
+    string_view text = batch_ptr->queued_text;
+    vector<Record_row> rows;
+    rows.reserve(batch_ptr->queued_records.size());
+    for (const Queued_record& queued : batch_ptr->queued_records) {
+        string_view medium = text.substr(queued.medium_begin, queued.title_begin - queued.medium_begin);
+        string_view title = text.substr(queued.title_begin, queued.title_end - queued.title_begin);
+        rows.push_back(Record_row{0, medium, title, 0});
+    }
+
+    vector<Record*> created = lib.add_records(rows);
+    for (size_t i = 0; i < rows.size(); ++i) {
+        if (created[i] == nullptr) {
+            report_batch_error(batch_ptr->queued_records[i].command_number,
+                "Library already has a record with this title!");
+            continue;
+        }
+        *report_ptr << "Record " << created[i]->get_ID() << " added\n";
+        journal_change("ar " + string(rows[i].medium) + " " + string(rows[i].title));
+    }
+
+    batch_ptr->queued_records.clear();
+    batch_ptr->queued_text.clear();
 }
 
-// Helper functions for Collection commands
+// Print the message of a failed command in the batch with its number,
+// and count it
+void report_batch_error(long long command_number, const char* error_msg)
+{
+    if (batch_ptr->num_failed++ == 0)
+        batch_ptr->first_failed = command_number;
+    cout << "Command " << command_number << ": " << error_msg << '\n';
+}
 
-// Read in a name and attempt to find the name in the given catalog.
-// Return an index of the found item but throw an Error if no item is found.
-Collection& find_collection_ref(Cat_t& cat)
+// Return true if a command in a transaction has failed
+bool is_transaction_failed()
 {
-    return cat[find_collection_iter(cat) - cat.cbegin()];
+    return batch_ptr != nullptr && batch_ptr->is_transaction && batch_ptr->num_failed > 0;
 }
 
-// Read in a name and attempt to find the name in the given catalog.
-// Return a const reference of the found item but throw an Error if
-// no item is found.
-const Collection& find_const_collection(const Cat_t& cat)
+// End the batch, if one is running: add the Records still queued, then
+// keep a transaction's changes, with a checkpoint if a journal is kept,
+// or undo them by going back to the journal or to no data. Print a
+// summary and return the exit status, which is 1 if a command failed.
+int end_batch(const Command_table& commands, Journal* journal, Library& lib, Catalog& cat)
 {
-    return cat[find_collection_iter(cat) - cat.cbegin()];
+    if (batch_ptr == nullptr)
+        return 0;
+
+    // Queued Records are not added to a transaction that has failed
+    if (!is_transaction_failed())
+        add_queued_records(lib);
+
+    Batch& batch = *batch_ptr;
+    batch_ptr = nullptr;
+    report_ptr = &cout;
+
+    // A batch too quick to time is reported at the rate of one microsecond
+    chrono::duration<double> seconds = chrono::steady_clock::now() - batch.start;
+    double commands_per_second = batch.num_commands / max(seconds.count(), 1e-6);
+    cout << "Batch done: " << batch.num_commands << " commands, " << batch.num_failed << " failed, "
+         << static_cast<long long>(commands_per_second) << " commands/s\n";
+
+    if (batch.is_transaction) {
+        try {
+            if (batch.num_failed == 0) {
+                journal_ptr = journal;
+                journal_checkpoint(lib, cat);
+                cout << "Transaction committed\n";
+            } else {
+                cat.clear(lib);
+                lib.clear();
+                if (journal != nullptr)
+                    replay_changes(journal->recover(lib, cat), commands, lib, cat);
+                journal_ptr = journal;
+                cout << "Transaction failed at command " << batch.first_failed << ", all changes undone\n";
+            }
+        } catch (Error& e) {
+            cout << e.msg << '\n';
+            return 1;
+        }
+    }
+    return batch.num_failed > 0 ? 1 : 0;
 }
 
+// Helper functions for Collection commands
+
 // Read in a name and attempt to find the name in the given catalog.
-// Return a const_iterator to the found item but throw an Error if
-// no item is found.
-Cat_citer find_collection_iter(const Cat_t& cat)
+// Return a reference to the found item but throw an Error if no item
+// is found. The reference stays valid until the Collection is deleted.
+Collection& find_collection_ref(Catalog& cat)
 {
-    string name;
-    cin >> name;
-
-    pair<Cat_citer, bool> iter_bool = cat_binary_search(cat, name);
-    if (!iter_bool.second)
+    Collection* col = cat.find(read_word());
+    if (col == nullptr)
         throw Error("No collection with that name!");
 
-    return iter_bool.first;
+    return *col;
 }
 
-// Read in a name, use lower_bound to find a Collection
-// and throw an Error if it already exists. Return an iterator
-// where a new Collection with the name should be inserted.
-Cat_citer find_and_check_if_already_present(const Cat_t& cat, const string& name)
+// Read in a name and attempt to find the name in the given catalog.
+// Return a const reference of the found item but throw an Error if
+// no item is found.
+const Collection& find_const_collection(const Catalog& cat)
 {
-    // Search the catalog and throw an Error if the Collection
-    // already exists.
-    pair<Cat_citer, bool> iter_bool = cat_binary_search(cat, name);
-
-    if (iter_bool.second)
-        throw Error("Catalog already has a collection with this name!");
+    const Collection* col = cat.find(read_word());
+    if (col == nullptr)
+        throw Error("No collection with that name!");
 
-    return iter_bool.first;
+    return *col;
 }
 
-// Perform lower_bound on the catalog to look for a Collection
-// Return a pair whose first member is a const_iterator to a member
-// of the vector while second member is a bool indicating whether the
-// Collection was found or not.
-pair<Cat_citer, bool> cat_binary_search(const Cat_t& cat, const string& name)
+// Throw an Error if the catalog already has a Collection with the name.
+void check_if_already_present(const Catalog& cat, string_view name)
 {
-    Cat_citer iter_found = lower_bound(
-        cat.cbegin(), cat.cend(), name, [&](const Collection& c1, const string&) { return c1.get_name() < name; });
-
-    // Case when the a matching Collection is found
-    if (iter_found != cat.cend() && iter_found->get_name() == name) {
-        pair<Cat_citer, bool> it_bool(iter_found, true);
-        return it_bool;
-    }
-    // When the Collection is not found
-    pair<Cat_citer, bool> it_bool(iter_found, false);
-    return it_bool;
+    if (cat.find(name) != nullptr)
+        throw Error("Catalog already has a collection with this name!");
 }
 
 // Helper functions for Record commands
 
 // Read in a Record ID, attempt to find a matching Record in
-// the given library, and return an iterator to the matching
+// the given library, and return a pointer to the matching
 // Record. Throw an Error if an integer could not be read, or
 // if there is no matching Record in the library.
-Lib_id_iter find_record_iter(const Lib_id_t& lib_id)
+Record* find_record_ptr(const Library& lib)
 {
     int id = read_record_id();
 
-    // Use lower_bound to search for a matching record via ID
+    // The ID indexes its slot directly.
     // Throw an Error if no matching item is found.
-    Lib_id_iter record_iter = lower_bound(
-        lib_id.cbegin(), lib_id.cend(), id, [&](const Record* r1, const int) { return r1->get_ID() < id; });
-
-    if (record_iter == lib_id.cend() || (*record_iter)->get_ID() != id)
+    Record* record_ptr = lib.find_id(id);
+    if (record_ptr == nullptr)
         throw Error("No record with that ID!");
 
-    return record_iter;
+    return record_ptr;
 }
 
 // Read in a title, attempt to find a matching Record in the given
 // library, and return the matching Record's pointer. Throw
-// an Error if a title could not be read, or if there is no
+// a Title_error if a title could not be read, or if there is no
 // matching Record in the library.
-Lib_ti_iter find_record_iter(const Lib_ti_t& lib_ti)
+Record* find_record_by_title(const Library& lib)
 {
-    string title = read_title();
-
-    // Use lower_bound to search for a matching record via title
-    // .first contains the iterator and .second contains a boolean
-    // indicating whether the item was found or not.
-    pair<Lib_ti_iter, bool> iter_bool = lib_binary_search(lib_ti, title);
+    string_view title = read_title();
 
     // Throw an Error if no matching item is found.
-    if (!iter_bool.second)
+    Record* record_ptr = lib.find_title(title);
+    if (record_ptr == nullptr)
         throw Title_error("No record with that title!");
 
-    return iter_bool.first;
+    return record_ptr;
 }
 
 // Read in a Record's ID and throw an Error if an
@@ -892,7 +1441,7 @@ Lib_ti_iter find_record_iter(const Lib_ti_t& lib_ti)
 // the given ID (it is less than 1).
 int read_record_id()
 {
-    int id_ = read_and_check_integer();
+    int id_ = read_and_check_integer(*input_ptr);
 
     if (id_ < 1)
         throw Error("No record with that ID!");
@@ -900,104 +1449,53 @@ int read_record_id()
     return id_;
 }
 
-// Custom functor class for read_title()
-class Remove_unneeded_white
+// Read in the rest of the line and remove unnecessary white spaces
+// from it. A line that has none is returned as it is, without copying;
+// the view is valid until the next read. Throw a Title_error if there
+// is only whitespace in the line that was read.
+string_view read_title()
 {
-public:
-    Remove_unneeded_white()
-        : initial_white(true)
-        , add_white(false)
-        , white_at_the_end(false)
-        , index(0)
-    { }
-    // Returns a boolean depending on whether we should add
-    // a character to a string or not
-    bool operator()(const char c)
-    {
-        bool is_space = (isspace(c));
-        // Return true if the char is not a white space
-        if (!is_space) {
-            // Done traversing through initial white spaces
-            initial_white = false;
-
-            // Allowed to add one white space
-            add_white = true;
-
-            // There is currently no white at the very end
-            white_at_the_end = false;
-            ++index;
-            return true;
-        }
-        // Add one white space if it is not an initial white space
-        // and if it is allowed to add one white space.
-        else if (!initial_white && is_space && add_white) {
-            // Not allowed to add more white spaces because
-            // one white space is already added
-            add_white = false;
-
-            // There is currently a white space at the end
-            white_at_the_end = true;
-
-            ++index;
-            return true;
-        }
-        // Don't add this white space.
-        else
-            return false;
-    }
-    // Getter functions
-    bool only_white()
-    {
-        return initial_white;
-    }
-    bool is_end_white()
-    {
-        return white_at_the_end;
-    }
-    int get_white_index()
-    {
-        return index - 1;
-    }
+    string_view title_in = input_ptr->read_line();
 
-private:
-    // initial_white indicates if we are reading the
-    // initial white spaces.
-    bool initial_white;
-
-    // add_white indicates if we should add the white space
-    // to the output string
-    bool add_white;
+    string_view title_out = title_in;
+    thread_local string cleaned;
+    if (!is_free_of_unneeded_white(title_in)) {
+        cleaned = remove_unneeded_white(title_in);
+        title_out = cleaned;
+    }
 
-    // white_at_the_end indicates if there is a white space
-    // at the the end of the output string
-    bool white_at_the_end;
+    // Throw a Title_error if there is only white space
+    if (title_out.empty())
+        throw Title_error("Could not read a title!");
 
-    // index keeps track of the last index in the output string
-    int index;
-};
+    return title_out;
+}
 
-// Read in a line from the input stream by using the getline function
-// and remove unnecessary white spaces from the line. Throw an Error
-// if there is only whitespace in the line that was read.
-string read_title()
+// Print the entries in order. With more than one parallel thread, a
+// window of the entries at a time is formatted in parts on the pool, each
+// part into its own string, and the strings are written in order, so the
+// output is the same as printing the entries one after another.
+void print_entries(const vector<const Record_entry*>& entries)
 {
-    string title_;
-    string title_out;
-
-    getline(cin, title_);
-
-    // Remove unnecessary white spaces in title_ and put the trimmed string
-    // into title_out
-    Remove_unneeded_white func;
-    copy_if(title_.cbegin(), title_.cend(), back_inserter(title_out), ref(func));
+    const size_t entries_per_window = 1 << 16;
+    const size_t min_entries_per_part = 1024;
 
-    // Throw a Title_error if there is only white space
-    if (func.only_white())
-        throw Title_error("Could not read a title!");
-
-    // If there is a whitespace at the end, erase the white space.
-    if (func.is_end_white())
-        title_out.erase(title_out.cbegin() + func.get_white_index());
+    ostream& os = *output_ptr;
+    if (parallel_threads() == 1) {
+        for (const Record_entry* entry_ptr : entries)
+            os << *entry_ptr;
+        return;
+    }
 
-    return title_out;
-}
\ No newline at end of file
+    for (size_t begin = 0; begin < entries.size(); begin += entries_per_window) {
+        size_t end = min(entries.size(), begin + entries_per_window);
+        vector<string> texts = parallel_collect(end - begin, min_entries_per_part, [&](size_t first, size_t last) {
+            ostringstream text;
+            for (size_t i = begin + first; i < begin + last; ++i)
+                text << *entries[i];
+            return text.str();
+        });
+        for (const string& text : texts)
+            os << text;
+    }
+}
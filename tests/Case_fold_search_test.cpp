@@ -0,0 +1,69 @@
+#include "Case_fold_search.h"
+#include "Check.h"
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <random>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+namespace {
+
+const Case_fold_kernel kernels[] = {Case_fold_kernel::scalar, Case_fold_kernel::sse2, Case_fold_kernel::avx2};
+
+// Return the position of the needle in the text, lower-cased, found the
+// plain way
+size_t find_lowered(string text, string_view lowered_needle)
+{
+    transform(text.begin(), text.end(), text.begin(), [](char c) { return (c >= 'A' && c <= 'Z') ? c + 32 : c; });
+    return text.find(lowered_needle);
+}
+
+// Every supported kernel agrees with a plain search on random text of
+// every length up to a few blocks, including needles that straddle the
+// blocks and the tail
+void test_kernels_agree()
+{
+    // A small alphabet so that needles are often found, with letters of
+    // both cases and bytes either side of the letter ranges
+    const string alphabet = "aAbB@[`{zZ ";
+    mt19937 random(7);
+    for (int round = 0; round < 20000; ++round) {
+        string text;
+        size_t text_size = random() % 100;
+        for (size_t i = 0; i < text_size; ++i)
+            text += alphabet[random() % alphabet.size()];
+        string needle;
+        size_t needle_size = 1 + random() % 6;
+        for (size_t i = 0; i < needle_size; ++i)
+            needle += static_cast<char>(tolower(alphabet[random() % alphabet.size()]));
+
+        size_t expected = find_lowered(text, needle);
+        CHECK(find_case_insensitive(text, needle) == expected);
+        for (Case_fold_kernel kernel : kernels) {
+            if (case_fold_kernel_supported(kernel))
+                CHECK(find_case_insensitive_with(kernel, text, needle) == expected);
+        }
+    }
+}
+
+void test_edge_cases()
+{
+    CHECK(case_fold_kernel_supported(Case_fold_kernel::scalar));
+    CHECK(case_fold_kernel_supported(chosen_case_fold_kernel()));
+    CHECK(find_case_insensitive("Anything", "") == 0);
+    CHECK(find_case_insensitive("", "a") == string_view::npos);
+    CHECK(find_case_insensitive("Star", "star wars") == string_view::npos);
+    CHECK(find_case_insensitive("Return of the KING", "the king") == 10);
+}
+
+}  // namespace
+
+int main()
+{
+    test_kernels_agree();
+    test_edge_cases();
+    return test_result();
+}
@@ -0,0 +1,33 @@
+/* CHECK reports a condition that does not hold, with its file and line,
+and counts the failure; a test program returns test_result() from main,
+so it fails if any check did.
+*/
+
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <iostream>
+
+inline int& num_failed_checks()
+{
+    static int num_failed = 0;
+    return num_failed;
+}
+
+inline void check(bool condition, const char* text, const char* file, int line)
+{
+    if (condition)
+        return;
+    std::cerr << file << ":" << line << ": check failed: " << text << '\n';
+    ++num_failed_checks();
+}
+
+#define CHECK(condition) check((condition), #condition, __FILE__, __LINE__)
+
+// Return the exit status of the test program
+inline int test_result()
+{
+    return num_failed_checks() == 0 ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,134 @@
+#include "Catalog.h"
+#include "Check.h"
+#include "Collection.h"
+#include "Library.h"
+#include "Memory_usage.h"
+#include "Record.h"
+#include <algorithm>
+#include <cstddef>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+const int num_records = 1000;
+
+// Fill the Library with Records whose titles are not in ID order
+void add_records(Library& lib)
+{
+    for (int i = 0; i < num_records; ++i)
+        lib.add_record("DVD", "Title " + to_string(i * 7919 % num_records));
+}
+
+// Return the IDs from first up to but not including last
+vector<int> id_range(int first, int last)
+{
+    vector<int> ids;
+    for (int id = first; id < last; ++id)
+        ids.push_back(id);
+    return ids;
+}
+
+// Return what print should write for the Collection, found by checking
+// every Record of the Library in title order
+string expected_print(const Collection& collection, const Library& lib)
+{
+    ostringstream os;
+    os << "Collection " << collection.get_name() << " contains:\n";
+    for (Record* record_ptr : lib) {
+        if (collection.is_member_present(record_ptr))
+            os << record_ptr;
+    }
+    return os.str();
+}
+
+// Return the bytes of collection members allocated at the most while
+// func runs, beyond those in use when it starts
+template <typename F>
+size_t members_allocated_during(F func)
+{
+    track_memory_peaks();
+    size_t before = memory_in_use(Memory_category::members);
+    func();
+    return memory_peak(Memory_category::members) - before;
+}
+
+// A Collection holding most of the Library is printed and saved in the
+// Library's title order without allocating, and a small one in the same
+// order by sorting its own members
+void test_print_and_save(Library& lib)
+{
+    Collection large("large", id_range(1, num_records / 2), lib);
+    Collection small("small", id_range(num_records / 2, num_records / 2 + 20), lib);
+
+    ostringstream printed;
+    CHECK(members_allocated_during([&] { large.print(printed, lib); }) == 0);
+    CHECK(printed.str() == expected_print(large, lib));
+
+    ostringstream saved;
+    CHECK(members_allocated_during([&] { large.save(saved, lib); }) == 0);
+    string save_lines = saved.str();
+    CHECK(save_lines.substr(0, save_lines.find('\n')) == "large " + to_string(large.size()));
+    CHECK(count(save_lines.begin(), save_lines.end(), '\n') == large.size() + 1);
+
+    ostringstream small_printed;
+    CHECK(members_allocated_during([&] { small.print(small_printed, lib); }) <= small.size() * sizeof(Record*));
+    CHECK(small_printed.str() == expected_print(small, lib));
+
+    large.clear(lib);
+    small.clear(lib);
+}
+
+// pC and sA visit the Catalog's Collections by reference, and cc moves
+// the combined Collection into the Catalog, so none of them copies a
+// member set
+void test_catalog_commands(Library& lib)
+{
+    Catalog cat;
+    cat.add(Collection("first", id_range(1, num_records / 2), lib), lib);
+    cat.add(Collection("second", id_range(num_records / 4, num_records), lib), lib);
+
+    ostringstream printed;
+    CHECK(members_allocated_during([&] {
+        for_each(cat.cbegin(), cat.cend(), [&](const Collection& collection) { collection.print(printed, lib); });
+    }) == 0);
+
+    ostringstream saved;
+    CHECK(members_allocated_during([&] {
+        for_each(cat.cbegin(), cat.cend(), [&](const Collection& collection) { collection.save(saved, lib); });
+    }) == 0);
+
+    // Only the combined member set itself is allocated
+    size_t before = memory_in_use(Memory_category::members);
+    size_t allocated = members_allocated_during(
+        [&] { cat.add(Collection(*cat.find("first"), *cat.find("second"), "both", lib), lib); });
+    CHECK(cat.find("both") != nullptr && cat.find("both")->size() == num_records - 1);
+    CHECK(allocated == memory_in_use(Memory_category::members) - before);
+
+    // A Collection whose name is taken releases its memberships
+    int memberships = lib.get_total_memberships();
+    CHECK(cat.add(Collection(*cat.find("first"), *cat.find("second"), "both", lib), lib) == nullptr);
+    CHECK(lib.get_total_memberships() == memberships);
+
+    cat.clear(lib);
+    CHECK(lib.get_total_memberships() == 0);
+}
+
+}  // namespace
+
+int main()
+{
+    {
+        Library lib;
+        add_records(lib);
+
+        test_print_and_save(lib);
+        test_catalog_commands(lib);
+    }
+
+    return test_result();
+}
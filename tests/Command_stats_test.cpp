@@ -0,0 +1,106 @@
+#include "Catalog.h"
+#include "Check.h"
+#include "Command_stats.h"
+#include "Command_table.h"
+#include "Library.h"
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+void no_op(Library&, Catalog&)
+{ }
+
+// Times below sub_buckets nanoseconds have a bucket each, every power of
+// two starts a bucket, and every bucket holds the times from one past
+// the top of the one before up to its own top, no more than a sixteenth
+// wider than that top
+void test_buckets()
+{
+    for (uint64_t nanoseconds = 0; nanoseconds < Command_stats::sub_buckets; ++nanoseconds) {
+        CHECK(Command_stats::bucket_of(nanoseconds) == static_cast<int>(nanoseconds));
+        CHECK(Command_stats::bucket_top(static_cast<int>(nanoseconds)) == nanoseconds);
+    }
+
+    for (int exponent = 4; exponent <= Command_stats::max_exponent; ++exponent) {
+        uint64_t power = uint64_t(1) << exponent;
+        int bucket = Command_stats::bucket_of(power);
+        CHECK(bucket == (exponent - 3) * Command_stats::sub_buckets);
+        CHECK(Command_stats::bucket_of(power - 1) == bucket - 1);
+        CHECK(Command_stats::bucket_top(bucket - 1) == power - 1);
+    }
+
+    for (int bucket = 0; bucket < Command_stats::num_buckets; ++bucket) {
+        uint64_t top = Command_stats::bucket_top(bucket);
+        CHECK(Command_stats::bucket_of(top) == bucket);
+        if (bucket + 1 < Command_stats::num_buckets)
+            CHECK(Command_stats::bucket_of(top + 1) == bucket + 1);
+        if (bucket > 0)
+            CHECK(top - Command_stats::bucket_top(bucket - 1) <= top / 16 + 1);
+    }
+
+    // Times too long for the last power of two go in the last bucket
+    uint64_t last_top = Command_stats::bucket_top(Command_stats::num_buckets - 1);
+    CHECK(last_top == (uint64_t(1) << (Command_stats::max_exponent + 1)) - 1);
+    CHECK(Command_stats::bucket_of(last_top + 1) == Command_stats::num_buckets - 1);
+    CHECK(Command_stats::bucket_of(UINT64_MAX) == Command_stats::num_buckets - 1);
+}
+
+// The percentiles are the tops of the buckets holding their ranks, but
+// never more than the longest time, and printing resets the counts
+void test_print_and_reset()
+{
+    const Command_table commands = {{"aa", no_op}, {"bb", no_op}, {"cc", no_op}, {"dd", no_op}};
+    Command_stats stats(commands);
+
+    // One run of each time from 1 to 100 microseconds
+    for (int i = 1; i <= 100; ++i) {
+        Command_stats::Outcome outcome = Command_stats::Outcome::done;
+        if (i % 40 == 0)
+            outcome = Command_stats::Outcome::error;
+        else if (i == 7)
+            outcome = Command_stats::Outcome::title_error;
+        stats.record(0, outcome, chrono::microseconds(i));
+    }
+    // Times below the first power of two buckets, and past the last
+    stats.record(2, Command_stats::Outcome::done, chrono::nanoseconds(5));
+    stats.record(2, Command_stats::Outcome::done, chrono::nanoseconds(9));
+    stats.record(3, Command_stats::Outcome::done, chrono::nanoseconds(uint64_t(1) << 50));
+    stats.record_unrecognized();
+    stats.record_unrecognized();
+
+    ostringstream first;
+    stats.print_and_reset(first);
+    CHECK(first.str()
+        == "Command statistics:\n"
+           "aa: 100 runs, 2 errors, 1 title errors; p50 51.2 us, p90 90.1 us, p99 100.0 us, max 100.0 us\n"
+           "cc: 2 runs, 0 errors, 0 title errors; p50 0.0 us, p90 0.0 us, p99 0.0 us, max 0.0 us\n"
+           "dd: 1 runs, 0 errors, 0 title errors; p50 281474976710.7 us, p90 281474976710.7 us, "
+           "p99 281474976710.7 us, max 1125899906842.6 us\n"
+           "Unrecognized commands: 2\n");
+
+    ostringstream second;
+    stats.print_and_reset(second);
+    CHECK(second.str() == "No commands have run\n");
+
+    // Counting starts over after a reset
+    stats.record(1, Command_stats::Outcome::done, chrono::nanoseconds(3000));
+    ostringstream third;
+    stats.print_and_reset(third);
+    CHECK(third.str()
+        == "Command statistics:\n"
+           "bb: 1 runs, 0 errors, 0 title errors; p50 3.0 us, p90 3.0 us, p99 3.0 us, max 3.0 us\n");
+}
+
+}  // namespace
+
+int main()
+{
+    test_buckets();
+    test_print_and_reset();
+    return test_result();
+}
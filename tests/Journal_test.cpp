@@ -0,0 +1,290 @@
+#include "Catalog.h"
+#include "Check.h"
+#include "Collection.h"
+#include "Journal.h"
+#include "Library.h"
+#include "Record.h"
+#include "Utility.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// The directory the test's files are made in, and the journal's name
+string directory;
+string journal_name;
+
+// Return the full name of a file in the test's directory
+string path_of(const string& name)
+{
+    return directory + "/" + name;
+}
+
+bool file_exists(const string& name)
+{
+    return access(name.c_str(), F_OK) == 0;
+}
+
+string read_file(const string& name)
+{
+    ifstream file(name, ios::binary);
+    return string(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+}
+
+void write_file(const string& name, const string& contents, ios::openmode mode = ios::trunc)
+{
+    ofstream file(name, ios::binary | mode);
+    file << contents;
+}
+
+// Remove the journal and its checkpoint, with any temporary files
+void remove_journal()
+{
+    for (const char* suffix : {"", ".tmp", ".checkpoint", ".checkpoint.tmp"})
+        remove((journal_name + suffix).c_str());
+}
+
+// Return the Library's Records, its next ID, and the Catalog's
+// Collections, in save format
+string contents(const Library& lib, const Catalog& cat)
+{
+    ostringstream os;
+    for (const Record* record_ptr : lib)
+        record_ptr->save(os);
+    os << "next " << lib.get_next_id() << '\n';
+    for (const Collection& collection : cat)
+        collection.save(os, lib);
+    return os.str();
+}
+
+// Fill the empty Library and Catalog with some Records and Collections
+void add_data(Library& lib, Catalog& cat, const string& prefix)
+{
+    vector<Record*> records;
+    for (int i = 0; i < 10; ++i) {
+        records.push_back(lib.add_record(i % 2 ? "CD" : "DVD", prefix + " " + to_string(i)));
+        lib.set_rating(records.back(), i % 6);
+    }
+    Collection* evens = cat.add(prefix + "_evens");
+    for (int i = 0; i < 10; i += 2)
+        evens->add_member(records[i], lib);
+    cat.add(prefix + "_empty");
+}
+
+// Recover the journal into a new Library and Catalog, check that they
+// hold the expected data, and return the changes to replay
+vector<string> recover_and_check(const string& expected)
+{
+    Journal journal(journal_name);
+    Library lib;
+    Catalog cat;
+    vector<string> changes = journal.recover(lib, cat);
+    CHECK(contents(lib, cat) == expected);
+    cat.clear(lib);
+    return changes;
+}
+
+// Write a checkpoint of new data and then journal two changes. Return
+// the contents of the checkpoint.
+string checkpoint_and_append(const string& prefix)
+{
+    remove_journal();
+    Journal journal(journal_name);
+    Library lib;
+    Catalog cat;
+    CHECK(journal.recover(lib, cat).empty());
+    add_data(lib, cat, prefix);
+    journal.checkpoint(lib, cat);
+    journal.append("mr 1 5");
+    journal.append("ac later");
+    journal.sync();
+    string saved = contents(lib, cat);
+    cat.clear(lib);
+    return saved;
+}
+
+// The checkpoint and the changes since are recovered, and a new journal
+// starts from an empty Library and Catalog
+void test_recover()
+{
+    remove_journal();
+    CHECK(recover_and_check(contents(Library(), Catalog())).empty());
+    CHECK(file_exists(journal_name) && file_exists(journal_name + ".checkpoint"));
+
+    string saved = checkpoint_and_append("Recover");
+    CHECK(recover_and_check(saved) == vector<string>({"mr 1 5", "ac later"}));
+}
+
+// Temporary files left by a crash before the journal was renamed into
+// place are ignored, and the next checkpoint writes over them
+void test_leftover_temp_files()
+{
+    string saved = checkpoint_and_append("Leftover");
+    write_file(journal_name + ".tmp", "0123abcd checkpoint 0000000000000000 1\n");
+    write_file(journal_name + ".checkpoint.tmp", "not a snapshot");
+    CHECK(recover_and_check(saved) == vector<string>({"mr 1 5", "ac later"}));
+
+    Journal journal(journal_name);
+    Library lib;
+    Catalog cat;
+    journal.recover(lib, cat);
+    journal.checkpoint(lib, cat);
+    CHECK(!file_exists(journal_name + ".tmp") && !file_exists(journal_name + ".checkpoint.tmp"));
+    cat.clear(lib);
+    CHECK(recover_and_check(saved).empty());
+}
+
+// A crash between the two renames leaves the new journal in place and
+// its checkpoint under the temporary name, next to the old checkpoint.
+// Recovery loads the new one and puts it in place.
+void test_crash_between_renames()
+{
+    checkpoint_and_append("Old");
+    string old_checkpoint = read_file(journal_name + ".checkpoint");
+    string saved = checkpoint_and_append("New");
+
+    CHECK(rename((journal_name + ".checkpoint").c_str(), (journal_name + ".checkpoint.tmp").c_str()) == 0);
+    write_file(journal_name + ".checkpoint", old_checkpoint);
+    CHECK(recover_and_check(saved) == vector<string>({"mr 1 5", "ac later"}));
+    CHECK(!file_exists(journal_name + ".checkpoint.tmp"));
+    CHECK(recover_and_check(saved) == vector<string>({"mr 1 5", "ac later"}));
+
+    // With neither checkpoint the journal's, recovery fails
+    write_file(journal_name + ".checkpoint", old_checkpoint);
+    bool is_thrown = false;
+    try {
+        recover_and_check(saved);
+    } catch (Error&) {
+        is_thrown = true;
+    }
+    CHECK(is_thrown);
+}
+
+// A last line cut short by a crash, or a damaged line and everything
+// after it, is dropped from the file, and appending goes on after the
+// lines that are kept
+void test_torn_lines()
+{
+    string saved = checkpoint_and_append("Torn");
+    size_t whole_size = read_file(journal_name).size();
+    write_file(journal_name, "1234abcd am Torn_evens", ios::app);
+    CHECK(recover_and_check(saved) == vector<string>({"mr 1 5", "ac later"}));
+    CHECK(read_file(journal_name).size() == whole_size);
+
+    write_file(journal_name, "00000000 dr 3\n", ios::app);
+    {
+        Journal journal(journal_name);
+        Library lib;
+        Catalog cat;
+        journal.recover(lib, cat);
+        journal.append("dr 2");
+        journal.sync();
+        cat.clear(lib);
+    }
+    CHECK(recover_and_check(saved) == vector<string>({"mr 1 5", "ac later", "dr 2"}));
+}
+
+bool ends_with(const string& text, const string& end)
+{
+    return text.size() >= end.size() && text.compare(text.size() - end.size(), end.size(), end) == 0;
+}
+
+// Run the program with its input from the file and return its output
+string run_program(const string& program, const string& arguments, const string& input)
+{
+    string input_name = path_of("input.txt");
+    string output_name = path_of("output.txt");
+    write_file(input_name, input);
+    string command = "'" + program + "' " + arguments + " < '" + input_name + "' > '" + output_name + "' 2>&1";
+    CHECK(system(command.c_str()) != -1);
+    string output = read_file(output_name);
+    remove(input_name.c_str());
+    remove(output_name.c_str());
+    return output;
+}
+
+// The program replays the journal when it starts, dropping a torn last
+// line, and printing the data then gives the same output as at the end
+// of the session that made the changes
+void test_program_replay(const string& program)
+{
+    const string changes = "ar DVD Alien\nar CD Blue Moon\nar DVD Star Wars\nar VHS It\nac fav\nam fav 1\n"
+                           "am fav 3\nmr 2 4\nmt 3 Return of the King\ndr 4\n";
+    const string print = "pL\npC\nqq\n";
+    const string journal_option = "--journal '" + journal_name + "'";
+
+    remove_journal();
+    string session = run_program(program, journal_option, changes + print);
+    CHECK(session.find("Return of the King") != string::npos);
+    string printed = run_program(program, journal_option, print);
+    CHECK(printed.find("Return of the King") != string::npos);
+    CHECK(ends_with(session, printed));
+
+    write_file(journal_name, "1234abcd ar DVD Torn", ios::app);
+    CHECK(run_program(program, journal_option, print) == printed);
+}
+
+// A failed transaction goes back to the data the journal holds, leaving
+// the journal and checkpoint as they were; one that succeeds is saved in
+// a new checkpoint on top of the replayed changes
+void test_program_transactions(const string& program)
+{
+    const string print = "pL\npC\nqq\n";
+    const string journal_option = "--journal '" + journal_name + "'";
+    const string script_name = path_of("script.txt");
+    const string transaction_option = journal_option + " -f '" + script_name + "' --transaction";
+
+    remove_journal();
+    run_program(program, journal_option, "ar DVD Alien\nar CD Blue Moon\nac fav\nam fav 1\nmr 2 4\nqq\n");
+    string printed = run_program(program, journal_option, print);
+    string journal = read_file(journal_name);
+    string checkpoint = read_file(journal_name + ".checkpoint");
+
+    write_file(script_name, "ar DVD Added\nmr 1 1\nam fav 3\ndc fav\ndr 99\n");
+    CHECK(run_program(program, transaction_option, "").find("all changes undone") != string::npos);
+    CHECK(read_file(journal_name) == journal);
+    CHECK(read_file(journal_name + ".checkpoint") == checkpoint);
+    CHECK(run_program(program, journal_option, print) == printed);
+
+    write_file(script_name, "ar DVD Added\nmr 1 1\nam fav 3\n");
+    CHECK(run_program(program, transaction_option, "").find("Transaction committed") != string::npos);
+    CHECK(read_file(journal_name + ".checkpoint") != checkpoint);
+    string committed = run_program(program, journal_option, print);
+    CHECK(committed != printed && committed.find("Added") != string::npos);
+    CHECK(committed.find("Blue Moon") != string::npos);
+    remove(script_name.c_str());
+}
+
+}  // namespace
+
+// The program to run is given on the command line
+int main(int argc, char* argv[])
+{
+    char directory_template[] = "/tmp/journal_test.XXXXXX";
+    if (argc < 2 || mkdtemp(directory_template) == nullptr) {
+        cerr << "Usage: " << argv[0] << " manager-program\n";
+        return 1;
+    }
+    directory = directory_template;
+    journal_name = path_of("data.journal");
+
+    test_recover();
+    test_leftover_temp_files();
+    test_crash_between_renames();
+    test_torn_lines();
+    test_program_replay(argv[1]);
+    test_program_transactions(argv[1]);
+
+    remove_journal();
+    rmdir(directory.c_str());
+    return test_result();
+}
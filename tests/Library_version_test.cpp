@@ -0,0 +1,217 @@
+#include "Check.h"
+#include "Epoch.h"
+#include "Library.h"
+#include "Library_version.h"
+#include "Memory_usage.h"
+#include "Record.h"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// Enough Records that every rating's tree has inner nodes
+const int num_records = 2000;
+
+// A copy of an entry that outlives the arena its title is in
+struct Entry_copy
+{
+    int id;
+    int rating;
+    string medium;
+    string title;
+
+    bool operator==(const Entry_copy& other) const
+    {
+        return id == other.id && rating == other.rating && medium == other.medium && title == other.title;
+    }
+};
+
+// Return copies of the version's entries in title order, checking that
+// each rating's tree holds its own rating in title order
+vector<Entry_copy> copy_entries(const Library_version& version)
+{
+    for (int rating = 0; rating < Library_version::num_ratings; ++rating) {
+        string_view previous;
+        size_t count = 0;
+        for (const Record_entry& entry : version.by_rating[rating]) {
+            CHECK(entry.rating == rating);
+            CHECK(count == 0 || previous < entry.title);
+            previous = entry.title;
+            ++count;
+        }
+        CHECK(count == version.by_rating[rating].size());
+    }
+
+    vector<Entry_copy> entries;
+    version.for_each_by_title([&entries](const Record_entry& entry) {
+        entries.push_back(Entry_copy{entry.id, entry.rating, *entry.medium, string(entry.title)});
+    });
+    return entries;
+}
+
+// Return copies of the Library's current data in title order
+vector<Entry_copy> copy_records(const Library& lib)
+{
+    vector<Entry_copy> entries;
+    for (const Record* record_ptr : lib)
+        entries.push_back(Entry_copy{record_ptr->get_ID(), record_ptr->get_rating(), record_ptr->get_medium(),
+            string(record_ptr->get_title())});
+    return entries;
+}
+
+// Return the title of the Record with the number
+string title_of(int i)
+{
+    return "Title " + to_string(100000 + i);
+}
+
+// A version a reader holds stays as it was while the Library is changed
+// and republished, with mr, mt, dr and ar, and the new version shows
+// every change
+void test_pinned_version_unchanged()
+{
+    Library lib;
+    vector<Record*> records;
+    for (int i = 0; i < num_records; ++i) {
+        records.push_back(lib.add_record("DVD", title_of(i)));
+        lib.set_rating(records.back(), i % 6);
+    }
+    lib.publish();
+
+    Epoch_guard guard;
+    const Library_version& old_version = lib.get_version();
+    vector<Entry_copy> old_entries = copy_entries(old_version);
+    CHECK(old_entries == copy_records(lib));
+    CHECK(old_version.size == num_records);
+
+    for (int i = 0; i < num_records; i += 7)
+        lib.set_rating(records[i], (i + 1) % 6);
+    for (int i = 3; i < num_records; i += 11)
+        CHECK(lib.retitle_record(records[i], "Retitled " + to_string(i)));
+    for (int i = 5; i < num_records; i += 13)
+        lib.remove_record(records[i]);
+    for (int i = 0; i < num_records / 10; ++i)
+        CHECK(lib.add_record("CD", "Added " + to_string(i)) != nullptr);
+    lib.publish();
+
+    CHECK(&lib.get_version() != &old_version);
+    CHECK(copy_entries(old_version) == old_entries);
+    CHECK(old_version.size == num_records);
+    CHECK(copy_entries(lib.get_version()) == copy_records(lib));
+    CHECK(lib.get_version().size == static_cast<int>(lib.size()));
+}
+
+// A node made since the last publication is changed in place, while one
+// already published is copied along with the path above it
+void test_copy_only_published_nodes()
+{
+    Library lib;
+    Record* first = lib.add_record("DVD", "First");
+    Record* second = lib.add_record("DVD", "Second");
+    lib.add_record("DVD", "Third");
+    lib.publish();
+
+    // The first change after publishing copies the one leaf
+    size_t published_bytes = memory_in_use(Memory_category::versions);
+    lib.set_rating(first, 4);
+    size_t copied_bytes = memory_in_use(Memory_category::versions);
+    CHECK(copied_bytes > published_bytes);
+
+    // Further changes to the same trees in the same epoch add no nodes
+    lib.set_rating(second, 4);
+    CHECK(lib.retitle_record(first, "Fourth"));
+    CHECK(memory_in_use(Memory_category::versions) == copied_bytes);
+
+    // After the next publication the working nodes are shared with
+    // readers, so they are copied again
+    lib.publish();
+    lib.set_rating(first, 0);
+    CHECK(memory_in_use(Memory_category::versions) > copied_bytes);
+}
+
+// Counts the items freed by its deleter
+size_t num_freed = 0;
+
+void count_freed(void* ptr)
+{
+    delete static_cast<int*>(ptr);
+    ++num_freed;
+}
+
+// Retired memory is freed only once no reader that entered a guard
+// before it was reclaimed remains in one
+void test_retire_and_reclaim()
+{
+    // With no reader, retired memory is freed at once
+    num_freed = 0;
+    uint64_t epoch = get_epoch();
+    retire(new int(1), count_freed);
+    CHECK(num_freed == 0);
+    reclaim_retired();
+    CHECK(num_freed == 1);
+    CHECK(get_epoch() == epoch + 1);
+
+    // A guard on this thread, even a nested one, holds the memory until
+    // the outer guard is left
+    {
+        Epoch_guard outer;
+        retire(new int(2), count_freed);
+        {
+            Epoch_guard inner;
+            reclaim_retired();
+        }
+        reclaim_retired();
+        CHECK(num_freed == 1);
+    }
+    reclaim_retired();
+    CHECK(num_freed == 2);
+
+    // A reader on another thread holds the memory retired while it is in
+    // its guard, but a reader that entered later does not
+    mutex step_mutex;
+    condition_variable step_changed;
+    int step = 0;
+    auto wait_for = [&](int wanted) {
+        unique_lock<mutex> lock(step_mutex);
+        step_changed.wait(lock, [&] { return step == wanted; });
+    };
+    auto move_to = [&](int next) {
+        lock_guard<mutex> lock(step_mutex);
+        step = next;
+        step_changed.notify_all();
+    };
+    thread reader([&] {
+        Epoch_guard guard;
+        move_to(1);
+        wait_for(2);
+    });
+    wait_for(1);
+    retire(new int(3), count_freed);
+    reclaim_retired();
+    CHECK(num_freed == 2);
+    {
+        Epoch_guard later;
+        move_to(2);
+        reader.join();
+        reclaim_retired();
+        CHECK(num_freed == 3);
+    }
+}
+
+}  // namespace
+
+int main()
+{
+    test_pinned_version_unchanged();
+    test_copy_only_published_nodes();
+    test_retire_and_reclaim();
+    return test_result();
+}
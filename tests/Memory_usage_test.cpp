@@ -0,0 +1,117 @@
+#include "Catalog.h"
+#include "Check.h"
+#include "Collection.h"
+#include "Library.h"
+#include "Memory_usage.h"
+#include "Record.h"
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+const int num_records = 2000;
+
+// Return the bytes in use in every category
+vector<size_t> usage_by_category()
+{
+    vector<size_t> usage;
+    for (int index = 0; index < num_memory_categories; ++index)
+        usage.push_back(memory_in_use(static_cast<Memory_category>(index)));
+    return usage;
+}
+
+// Check that each category is back to its value at the start
+void check_usage_restored(const vector<size_t>& start)
+{
+    vector<size_t> now = usage_by_category();
+    for (int index = 0; index < num_memory_categories; ++index) {
+        if (now[index] != start[index])
+            cerr << memory_category_name(static_cast<Memory_category>(index)) << ": " << start[index]
+                 << " bytes at the start, " << now[index] << " now\n";
+        CHECK(now[index] == start[index]);
+    }
+}
+
+// Fill the Library and Catalog, changing titles and ratings and
+// combining Collections along the way
+void add_data(Library& lib, Catalog& cat)
+{
+    vector<Record*> records;
+    for (int i = 0; i < num_records; ++i)
+        records.push_back(lib.add_record("DVD", "Title " + to_string(i)));
+    lib.publish();
+
+    for (int i = 0; i < num_records; i += 2) {
+        lib.retitle_record(records[i], "A much longer title than before, number " + to_string(i));
+        lib.set_rating(records[i], i % 6);
+    }
+
+    Collection* evens = cat.add("evens");
+    Collection* thirds = cat.add("thirds");
+    for (int i = 0; i < num_records; ++i) {
+        if (i % 2 == 0)
+            evens->add_member(records[i], lib);
+        if (i % 3 == 0)
+            thirds->add_member(records[i], lib);
+    }
+    cat.add(Collection(*evens, *thirds, "both", lib), lib);
+    cat.add(Collection::intersect(*evens, *thirds, "sixths", lib), lib);
+    lib.publish();
+}
+
+// Removing every Collection and Record one at a time gives back the
+// memory of the Records, the members, and the Catalog at once, and the
+// rest once the Library is gone
+void test_remove_each(const vector<size_t>& start)
+{
+    {
+        Library lib;
+        Catalog cat;
+        add_data(lib, cat);
+
+        while (!cat.empty())
+            cat.remove(*cat.begin(), lib);
+        while (!lib.empty())
+            lib.remove_record(*lib.begin());
+        lib.publish();
+
+        CHECK(lib.get_total_memberships() == 0);
+        CHECK(memory_in_use(Memory_category::records) == start[static_cast<int>(Memory_category::records)]);
+        CHECK(memory_in_use(Memory_category::members) == start[static_cast<int>(Memory_category::members)]);
+        CHECK(memory_in_use(Memory_category::catalog) == start[static_cast<int>(Memory_category::catalog)]);
+    }
+    check_usage_restored(start);
+}
+
+// Clearing the Catalog and the Library gives back the same memory
+void test_clear(const vector<size_t>& start)
+{
+    {
+        Library lib;
+        Catalog cat;
+        add_data(lib, cat);
+
+        cat.clear(lib);
+        lib.clear();
+        lib.publish();
+    }
+    check_usage_restored(start);
+}
+
+}  // namespace
+
+int main()
+{
+    vector<size_t> start = usage_by_category();
+    size_t total_start = total_memory_in_use();
+
+    test_remove_each(start);
+    test_clear(start);
+    CHECK(total_memory_in_use() == total_start);
+
+    return test_result();
+}